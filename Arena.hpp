@@ -0,0 +1,100 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Alocador em blocos para dados que vivem tanto quanto a cena: os objetos são criados
+// em sequência dentro de blocos grandes, que nunca são realocados, então os endereços
+// ficam estáveis, e tudo é liberado de uma vez em release() (ou no destrutor), com os
+// destrutores chamados na ordem inversa da criação. Não é seguro para várias threads.
+class Arena {
+    public:
+        Arena(size_t block_size = 64 * 1024): block_size {block_size} {}
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        // Mover a arena não move os blocos: os ponteiros já entregues continuam válidos
+        Arena(Arena &&other) noexcept { swap(other); }
+        Arena& operator=(Arena &&other) noexcept {
+            if (this != &other) {
+                release();
+                swap(other);
+            }
+            return *this;
+        }
+        ~Arena() { release(); }
+
+        // Constrói um T na arena; ele é destruído em release()
+        template <typename T, typename... Args>
+        T* create(Args&&... args) {
+            T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                destructors = new (allocate(sizeof(Destructor), alignof(Destructor)))
+                    Destructor {[](void *p) { static_cast<T*>(p)->~T(); }, object, destructors};
+            }
+            return object;
+        }
+
+        // 'size' bytes alinhados a 'alignment' (potência de 2), válidos até release()
+        void* allocate(size_t size, size_t alignment) {
+            uintptr_t start = ((uintptr_t) (current + used) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+            if (!current || start + size > (uintptr_t) (current + capacity)) {
+                // Pedidos maiores que um bloco ganham um bloco só para eles
+                capacity = std::max(block_size, size + alignment);
+                blocks.emplace_back(new char[capacity]);
+                current = blocks.back().get();
+                used = 0;
+                reserved += capacity;
+                start = ((uintptr_t) current + alignment - 1) & ~(uintptr_t) (alignment - 1);
+            }
+            used = start + size - (uintptr_t) current;
+            allocated += size;
+            return (void*) start;
+        }
+
+        // Destrói tudo o que foi criado e devolve os blocos
+        void release() {
+            for (Destructor *d = destructors; d; d = d->next) d->destroy(d->object);
+            destructors = nullptr;
+            blocks.clear();
+            current = nullptr;
+            used = capacity = 0;
+            allocated = reserved = 0;
+        }
+
+        size_t bytes_allocated() const { return allocated; }
+        size_t bytes_reserved() const { return reserved; }
+
+        void swap(Arena &other) {
+            std::swap(block_size, other.block_size);
+            blocks.swap(other.blocks);
+            std::swap(current, other.current);
+            std::swap(used, other.used);
+            std::swap(capacity, other.capacity);
+            std::swap(allocated, other.allocated);
+            std::swap(reserved, other.reserved);
+            std::swap(destructors, other.destructors);
+        }
+
+    private:
+        // Registro de destruição, guardado na própria arena; a lista vai do mais novo ao mais antigo
+        struct Destructor {
+            void (*destroy)(void*);
+            void *object;
+            Destructor *next;
+        };
+
+        size_t block_size = 64 * 1024;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char *current = nullptr;
+        size_t used = 0, capacity = 0;
+        size_t allocated = 0, reserved = 0;
+        Destructor *destructors = nullptr;
+};
+
+#endif
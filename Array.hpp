@@ -0,0 +1,91 @@
+#ifndef ARRAY_HPP
+#define ARRAY_HPP
+#include <stddef.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Vetor que pode ou possuir seus elementos (std::vector interno) ou apenas apontar
+// para memória externa, como um arquivo de cache mapeado, sem copiá-la.
+// A leitura é igual nos dois casos; qualquer modificação de um array emprestado
+// primeiro copia os elementos para armazenamento próprio.
+template <typename T>
+class Array {
+    public:
+        Array() {}
+        Array(size_t n, const T &value): owned(n, value) {}
+
+        Array(const Array &other) { *this = other; }
+        Array& operator=(const Array &other) {
+            owned = other.owned;
+            borrowed = other.borrowed;
+            borrowed_size = other.borrowed_size;
+            keep_alive = other.keep_alive;
+            return *this;
+        }
+        Array(Array &&other) noexcept { swap(other); }
+        Array& operator=(Array &&other) noexcept { swap(other); return *this; }
+
+        // Passa a apontar para 'n' elementos em 'data'; 'owner' mantém essa memória viva
+        void borrow(const T *data, size_t n, std::shared_ptr<const void> owner) {
+            std::vector<T>().swap(owned);
+            borrowed = data;
+            borrowed_size = n;
+            keep_alive = std::move(owner);
+        }
+        bool is_borrowed() const { return borrowed != nullptr; }
+
+        // Toma posse do conteúdo de um std::vector sem copiar
+        void take(std::vector<T> &v) {
+            release();
+            owned.swap(v);
+        }
+
+        inline size_t size() const { return borrowed? borrowed_size : owned.size(); }
+        inline bool empty() const { return size() == 0; }
+        inline const T* data() const { return borrowed? borrowed : owned.data(); }
+        inline const T& operator[](size_t i) const { return data()[i]; }
+        inline const T* begin() const { return data(); }
+        inline const T* end() const { return data() + size(); }
+        inline const T& back() const { return data()[size() - 1]; }
+
+        // Acesso para escrita: desfaz o empréstimo se necessário
+        inline T* data() { detach(); return owned.data(); }
+        inline T& operator[](size_t i) { detach(); return owned[i]; }
+        inline T* begin() { detach(); return owned.data(); }
+        inline T* end() { detach(); return owned.data() + owned.size(); }
+        inline T& back() { detach(); return owned.back(); }
+
+        void push_back(const T &value) { detach(); owned.push_back(value); }
+        void reserve(size_t n) { detach(); owned.reserve(n); }
+        void resize(size_t n) { detach(); owned.resize(n); }
+        void assign(size_t n, const T &value) { release(); owned.assign(n, value); }
+        void clear() { release(); owned.clear(); }
+        void shrink_to_fit() { detach(); owned.shrink_to_fit(); }
+
+        void swap(Array &other) {
+            owned.swap(other.owned);
+            std::swap(borrowed, other.borrowed);
+            std::swap(borrowed_size, other.borrowed_size);
+            keep_alive.swap(other.keep_alive);
+        }
+
+    private:
+        std::vector<T> owned;
+        const T *borrowed = nullptr;
+        size_t borrowed_size = 0;
+        std::shared_ptr<const void> keep_alive;
+
+        void detach() {
+            if (!borrowed) return;
+            owned.assign(borrowed, borrowed + borrowed_size);
+            release();
+        }
+        void release() {
+            borrowed = nullptr;
+            borrowed_size = 0;
+            keep_alive.reset();
+        }
+};
+
+#endif
@@ -0,0 +1,555 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+#include "Vector3.hpp"
+#include "BoundingBox.hpp"
+#include "SIMD.hpp"
+#include "Array.hpp"
+#include "ThreadPool.hpp"
+#include <math.h>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include <algorithm>
+
+// Hierarquia de volumes envolventes sobre primitivas arbitrárias.
+// A BVH só conhece as caixas das primitivas; quem a usa fornece o teste
+// de interseção de cada primitiva (por índice) durante a travessia.
+class BVH {
+    public:
+        struct Node {
+            BoundingBox bounds;
+            int first; // folha: primeiro índice em 'indices'; nó interno: filho esquerdo (o direito é first + 1)
+            int count; // número de primitivas na folha, 0 para nós internos
+            inline bool is_leaf() const { return count > 0; }
+        };
+
+        Array<Node> nodes;
+        Array<int> indices;
+
+        int max_leaf_size = 4;
+        double traversal_cost = 1.0;
+        double intersection_cost = 1.0;
+        // Primitivas testadas de uma vez numa folha (4 quando as folhas viram blocos SIMD):
+        // a SAH cobra por grupo, então folhas com o grupo incompleto deixam de ser vantagem
+        int leaf_width = 1;
+
+        static const int max_depth = 64;
+
+        // Qualidade da construção, do mais rápido ao melhor
+        enum Quality {
+            FAST,   // divide no meio do maior eixo dos centróides; bom para prévias
+            BINNED, // SAH avaliada em 'bins' posições por eixo; quase a árvore de FULL
+            FULL    // SAH avaliada em todas as partições possíveis dos três eixos
+        };
+        Quality quality = BINNED;
+        int bins = 32; // no máximo 64
+        // Threads da construção (0 = todos os núcleos). Nós com pelo menos parallel_threshold
+        // primitivas são divididos um a um com o binning em paralelo; abaixo disso cada
+        // subárvore vira uma tarefa. A árvore é a mesma com qualquer número de threads.
+        int build_threads = 0;
+        int parallel_threshold = 1 << 14;
+
+        // Tempo e qualidade da última construção
+        struct BuildStats {
+            double seconds = 0;
+            double sah_cost = 0; // custo esperado de um raio que atinge a raiz, pela SAH
+            int depth = 0;
+            int leaves = 0;
+            int smallest_leaf = 0;
+            int largest_leaf = 0;
+            double average_leaf = 0;
+
+            void print(std::ostream &os) const {
+                os << "BVH: " << seconds << " s, custo SAH " << sah_cost << ", profundidade " << depth
+                   << ", " << leaves << " folhas com " << smallest_leaf << " a " << largest_leaf
+                   << " primitivas (média " << average_leaf << ")";
+            }
+        };
+        BuildStats build_stats;
+
+        // Constrói a árvore sobre as caixas das primitivas, com a heurística de área de superfície (SAH)
+        void build(const std::vector<BoundingBox> &primitive_bounds) {
+            auto start = std::chrono::steady_clock::now();
+            nodes.clear();
+            indices.clear();
+            build_stats = BuildStats();
+            if (primitive_bounds.empty()) return;
+
+            bounds = &primitive_bounds;
+            centroids.clear();
+            centroids.reserve(primitive_bounds.size());
+            for (const BoundingBox &b : primitive_bounds) centroids.push_back(b.center());
+
+            int n = (int) primitive_bounds.size();
+            indices.resize(n);
+            for (int i = 0; i < n; i++) indices[i] = i;
+
+            int thread_count = (build_threads > 0)? build_threads : ThreadPool::default_thread_count();
+            std::unique_ptr<ThreadPool> pool;
+            if (thread_count > 1 && n >= parallel_threshold) pool.reset(new ThreadPool(thread_count));
+
+            BuildNode root(0, n);
+            compute_bounds(root, pool.get());
+
+            // Níveis de cima, na thread atual: nós grandes são divididos com o trabalho de
+            // cada nó espalhado pelo pool; os nós que sobram são subárvores independentes
+            std::vector<std::pair<BuildNode*, int>> pending {{&root, 1}}, subtrees;
+            while (!pending.empty()) {
+                std::pair<BuildNode*, int> entry = pending.back();
+                pending.pop_back();
+                BuildNode &node = *entry.first;
+                if (!pool || node.count < parallel_threshold) {
+                    subtrees.push_back(entry);
+                } else if (split(node, entry.second, pool.get())) {
+                    pending.push_back({node.children[1].get(), entry.second + 1});
+                    pending.push_back({node.children[0].get(), entry.second + 1});
+                }
+            }
+            if (pool) {
+                for (auto &entry : subtrees) pool->submit([this, entry] { build_subtree(*entry.first, entry.second); });
+                pool->wait();
+                pool.reset();
+            } else {
+                for (auto &entry : subtrees) build_subtree(*entry.first, entry.second);
+            }
+
+            nodes.reserve(2 * n);
+            nodes.push_back(Node());
+            flatten(root, 0);
+
+            bounds = nullptr;
+            centroids.clear();
+            centroids.shrink_to_fit();
+
+            measure(0, 1, nodes[0].bounds.surface_area());
+            if (build_stats.leaves > 0) build_stats.average_leaf = (double) n / build_stats.leaves;
+            build_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Travessia em ordem de proximidade: o filho mais próximo é visitado
+        // primeiro e nós mais distantes que o acerto atual são descartados.
+        // 'test(i, t_max)' deve testar a primitiva i e reduzir t_max ao encontrar um acerto mais próximo.
+        template <typename Intersector>
+        void intersect(const Vector3 &origin, const Vector3 &direction, double &t_max, Intersector &&test) const {
+            intersect_leaves(origin, direction, t_max, [&](int node_index, double &t) {
+                const Node &leaf = nodes[node_index];
+                for (int i = leaf.first; i < leaf.first + leaf.count; i++) test(indices[i], t);
+            });
+        }
+
+        // Como intersect, mas entrega folhas inteiras: 'test(node_index, t_max)'.
+        // Permite testar as primitivas de uma folha de uma só vez (por exemplo, com SIMD).
+        template <typename LeafIntersector>
+        void intersect_leaves(const Vector3 &origin, const Vector3 &direction, double &t_max, LeafIntersector &&test) const {
+            if (nodes.empty()) return;
+            Vector3 inv_dir(1.0 / direction.x(), 1.0 / direction.y(), 1.0 / direction.z());
+
+            struct Entry { int node; double t; } stack[max_depth + 1];
+            int top = 0;
+
+            double t_root;
+            if (!nodes[0].bounds.hit(origin, inv_dir, t_max, t_root)) return;
+            stack[top++] = {0, t_root};
+
+            while (top > 0) {
+                Entry entry = stack[--top];
+                if (entry.t > t_max) continue;
+                const Node &node = nodes[entry.node];
+
+                if (node.is_leaf()) {
+                    test(entry.node, t_max);
+                    continue;
+                }
+
+                double t_left = 0, t_right = 0;
+                bool hit_left  = nodes[node.first].bounds.hit(origin, inv_dir, t_max, t_left);
+                bool hit_right = nodes[node.first + 1].bounds.hit(origin, inv_dir, t_max, t_right);
+
+                if (hit_left && hit_right) {
+                    // Empilha o mais distante primeiro para que o mais próximo seja visitado antes
+                    if (t_left <= t_right) {
+                        stack[top++] = {node.first + 1, t_right};
+                        stack[top++] = {node.first, t_left};
+                    } else {
+                        stack[top++] = {node.first, t_left};
+                        stack[top++] = {node.first + 1, t_right};
+                    }
+                }
+                else if (hit_left)  stack[top++] = {node.first, t_left};
+                else if (hit_right) stack[top++] = {node.first + 1, t_right};
+            }
+        }
+
+        // Travessia de um pacote de quatro raios: um nó é visitado se algum raio ativo
+        // o atingir antes do seu acerto atual. 't_max' tem a distância máxima de cada faixa
+        // (alinhado a 32 bytes) e 'test(i, mask)' testa a primitiva i nas faixas de 'mask'.
+        template <typename Intersector>
+        void intersect_packet(const RayPacket4 &rays, const double *t_max, Intersector &&test) const {
+            intersect_packet_leaves(rays, t_max, [&](int node_index, int mask) {
+                const Node &leaf = nodes[node_index];
+                for (int i = leaf.first; i < leaf.first + leaf.count; i++) test(indices[i], mask);
+            });
+        }
+
+        // Como intersect_packet, mas entrega folhas inteiras: 'test(node_index, mask)'
+        template <typename LeafIntersector>
+        void intersect_packet_leaves(const RayPacket4 &rays, const double *t_max, LeafIntersector &&test) const {
+            if (nodes.empty() || !rays.active) return;
+
+            struct Entry { int node; int mask; } stack[max_depth + 1];
+            int top = 0;
+            stack[top++] = {0, rays.active};
+
+            // Direção do primeiro raio ativo, usada para ordenar os filhos
+            int lead = 0;
+            while (!(rays.active & (1 << lead))) lead++;
+            Vector3 lead_direction = rays.get_direction(lead);
+
+            alignas(32) double t_near[4];
+            while (top > 0) {
+                Entry entry = stack[--top];
+                const Node &node = nodes[entry.node];
+                int mask = rays.hit(node.bounds, t_max, t_near) & entry.mask;
+                if (!mask) continue;
+
+                if (node.is_leaf()) {
+                    test(entry.node, mask);
+                    continue;
+                }
+
+                const BoundingBox &left = nodes[node.first].bounds, &right = nodes[node.first + 1].bounds;
+                if ((left.center() - right.center()).dot(lead_direction) > 0) {
+                    stack[top++] = {node.first, mask};
+                    stack[top++] = {node.first + 1, mask};
+                } else {
+                    stack[top++] = {node.first + 1, mask};
+                    stack[top++] = {node.first, mask};
+                }
+            }
+        }
+
+        // Travessia sem ordenação que para no primeiro 'test(i)' verdadeiro.
+        // Usada quando basta saber se algo é atingido, não o que é atingido primeiro.
+        template <typename Tester>
+        bool any(const Vector3 &origin, const Vector3 &direction, double t_max, Tester &&test) const {
+            return any_leaf(origin, direction, t_max, [&](int node_index) {
+                const Node &leaf = nodes[node_index];
+                for (int i = leaf.first; i < leaf.first + leaf.count; i++) {
+                    if (test(indices[i])) return true;
+                }
+                return false;
+            });
+        }
+
+        // Como any, mas entrega folhas inteiras: 'test(node_index)'
+        template <typename LeafTester>
+        bool any_leaf(const Vector3 &origin, const Vector3 &direction, double t_max, LeafTester &&test) const {
+            if (nodes.empty()) return false;
+            Vector3 inv_dir(1.0 / direction.x(), 1.0 / direction.y(), 1.0 / direction.z());
+
+            int stack[max_depth + 1];
+            int top = 0;
+            stack[top++] = 0;
+
+            double t_near;
+            while (top > 0) {
+                int node_index = stack[--top];
+                const Node &node = nodes[node_index];
+                if (!node.bounds.hit(origin, inv_dir, t_max, t_near)) continue;
+
+                if (node.is_leaf()) {
+                    if (test(node_index)) return true;
+                    continue;
+                }
+                stack[top++] = node.first + 1;
+                stack[top++] = node.first;
+            }
+            return false;
+        }
+
+        // Chama 'visit(i)' para cada primitiva de folha cuja caixa contém o ponto 'p'
+        template <typename Visitor>
+        void containing(const Vector3 &p, Visitor &&visit) const {
+            if (nodes.empty()) return;
+            int stack[max_depth + 1];
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const Node &node = nodes[stack[--top]];
+                if (!node.bounds.contains(p)) continue;
+                if (node.is_leaf()) {
+                    for (int i = node.first; i < node.first + node.count; i++) visit(indices[i]);
+                    continue;
+                }
+                stack[top++] = node.first + 1;
+                stack[top++] = node.first;
+            }
+        }
+
+    private:
+        const std::vector<BoundingBox> *bounds = nullptr;
+        std::vector<Vector3> centroids;
+
+        // Nó da árvore durante a construção; no fim ela é copiada para 'nodes' na ordem em profundidade
+        struct BuildNode {
+            int begin, count;
+            BoundingBox bounds;
+            BoundingBox centroid_bounds;
+            std::unique_ptr<BuildNode> children[2];
+            BuildNode(int begin, int count): begin {begin}, count {count} {}
+        };
+
+        static const int max_bins = 64;
+
+        // Contagem e caixa das primitivas em cada intervalo dos três eixos
+        struct Bins {
+            int count[3][max_bins];
+            BoundingBox bounds[3][max_bins];
+            Bins() {
+                for (int axis = 0; axis < 3; axis++) {
+                    for (int b = 0; b < max_bins; b++) count[axis][b] = 0;
+                }
+            }
+            void merge(const Bins &other) {
+                for (int axis = 0; axis < 3; axis++) {
+                    for (int b = 0; b < max_bins; b++) {
+                        count[axis][b] += other.count[axis][b];
+                        bounds[axis][b].expand(other.bounds[axis][b]);
+                    }
+                }
+            }
+        };
+
+        void build_subtree(BuildNode &node, int depth) {
+            if (!split(node, depth, nullptr)) return;
+            build_subtree(*node.children[0], depth + 1);
+            build_subtree(*node.children[1], depth + 1);
+        }
+
+        // Decide se o nó vira folha; se não, reordena seus índices e cria os dois filhos
+        bool split(BuildNode &node, int depth, ThreadPool *pool) {
+            int begin = node.begin, count = node.count;
+            if (count <= 1 || depth >= max_depth) return false;
+
+            double best_cost = INFINITY; // soma de área vezes número de grupos de primitivas dos dois lados
+            int middle;
+            if (quality == FULL) middle = full_split(begin, begin + count, best_cost);
+            else if (quality == BINNED) {
+                // Com poucas primitivas a varredura completa sai mais barata que os intervalos
+                middle = (count <= bins)? full_split(begin, begin + count, best_cost) : binned_split(node, pool, best_cost);
+            }
+            else middle = midpoint_split(node);
+
+            if (middle < 0) {
+                // Centróides coincidentes: nenhuma partição espacial separa as primitivas
+                if (count <= max_leaf_size) return false;
+                middle = begin + count / 2;
+            } else {
+                double parent_area = node.bounds.surface_area();
+                double split_cost = traversal_cost + intersection_cost * ((parent_area > 0)? best_cost / parent_area : groups(count));
+                double leaf_cost = intersection_cost * groups(count);
+                if (count <= max_leaf_size && leaf_cost <= split_cost) return false;
+            }
+
+            node.children[0].reset(new BuildNode(begin, middle - begin));
+            node.children[1].reset(new BuildNode(middle, begin + count - middle));
+            compute_bounds(*node.children[0], pool);
+            compute_bounds(*node.children[1], pool);
+            return true;
+        }
+
+        // Avalia todas as partições possíveis ao longo dos três eixos
+        int full_split(int begin, int end, double &best_cost) {
+            int count = end - begin;
+            int best_axis = -1, best_split = -1;
+            std::vector<double> right_area(count);
+
+            for (int axis = 0; axis < 3; axis++) {
+                sort_by_axis(begin, end, axis);
+
+                // Áreas acumuladas da direita para a esquerda
+                BoundingBox right;
+                for (int i = count - 1; i > 0; i--) {
+                    right.expand((*bounds)[indices[begin + i]]);
+                    right_area[i] = right.surface_area();
+                }
+                // Varredura da esquerda: a partição em i deixa [0, i) à esquerda e [i, count) à direita
+                BoundingBox left;
+                for (int i = 1; i < count; i++) {
+                    left.expand((*bounds)[indices[begin + i - 1]]);
+                    double cost = left.surface_area() * groups(i) + right_area[i] * groups(count - i);
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = i;
+                    }
+                }
+            }
+            sort_by_axis(begin, end, best_axis);
+            return begin + best_split;
+        }
+
+        // SAH avaliada nas fronteiras de 'bins' intervalos iguais dos centróides em cada eixo
+        int binned_split(const BuildNode &node, ThreadPool *pool, double &best_cost) {
+            const BoundingBox &cb = node.centroid_bounds;
+            int end = node.begin + node.count;
+            int bins = std::min(std::max(this->bins, 2), (int) max_bins);
+
+            int chunks = chunk_count(pool, node.count);
+            std::vector<Bins> partial(chunks);
+            for_chunks(pool, node.begin, end, chunks, [&](int chunk, int first, int last) {
+                Bins &b = partial[chunk];
+                for (int i = first; i < last; i++) {
+                    int p = indices[i];
+                    for (int axis = 0; axis < 3; axis++) {
+                        int k = bin_of(centroids[p], cb, axis, bins);
+                        if (k < 0) continue;
+                        b.count[axis][k]++;
+                        b.bounds[axis][k].expand((*bounds)[p]);
+                    }
+                }
+            });
+            for (int c = 1; c < chunks; c++) partial[0].merge(partial[c]);
+            const Bins &b = partial[0];
+
+            int best_axis = -1, best_bin = -1;
+            double right_cost[max_bins];
+            for (int axis = 0; axis < 3; axis++) {
+                if (cb.max[axis] <= cb.min[axis]) continue;
+                // right_cost[k]: área vezes número de primitivas dos intervalos [k, bins)
+                BoundingBox right;
+                int right_count = 0;
+                for (int k = bins - 1; k > 0; k--) {
+                    right.expand(b.bounds[axis][k]);
+                    right_count += b.count[axis][k];
+                    right_cost[k] = right_count? right.surface_area() * groups(right_count) : -1;
+                }
+                BoundingBox left;
+                int left_count = 0;
+                for (int k = 1; k < bins; k++) {
+                    left.expand(b.bounds[axis][k - 1]);
+                    left_count += b.count[axis][k - 1];
+                    if (left_count == 0 || right_cost[k] < 0) continue;
+                    double cost = left.surface_area() * groups(left_count) + right_cost[k];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = k;
+                    }
+                }
+            }
+            if (best_axis < 0) return -1;
+            auto middle = std::partition(indices.begin() + node.begin, indices.begin() + end, [&](int p) {
+                return bin_of(centroids[p], cb, best_axis, bins) < best_bin;
+            });
+            return (int) (middle - indices.begin());
+        }
+
+        // Divide no meio do maior eixo dos centróides, sem avaliar custo
+        int midpoint_split(const BuildNode &node) {
+            const BoundingBox &cb = node.centroid_bounds;
+            int axis = cb.largest_axis();
+            if (cb.max[axis] <= cb.min[axis]) return -1;
+            double mid = 0.5 * ((double) cb.min[axis] + cb.max[axis]);
+            auto middle = std::partition(indices.begin() + node.begin, indices.begin() + node.begin + node.count, [&](int p) {
+                return centroids[p][axis] < mid;
+            });
+            return (int) (middle - indices.begin());
+        }
+
+        // Intervalo do centróide 'c' no eixo 'axis' (-1 se o eixo não tem extensão)
+        static inline int bin_of(const Vector3 &c, const BoundingBox &cb, int axis, int bins) {
+            double extent = (double) cb.max[axis] - cb.min[axis];
+            if (extent <= 0) return -1;
+            int k = (int) (((double) c[axis] - cb.min[axis]) * bins / extent);
+            return std::min(std::max(k, 0), bins - 1);
+        }
+
+        void compute_bounds(BuildNode &node, ThreadPool *pool) {
+            int chunks = chunk_count(pool, node.count);
+            std::vector<BoundingBox> box(chunks), centroid_box(chunks);
+            for_chunks(pool, node.begin, node.begin + node.count, chunks, [&](int chunk, int first, int last) {
+                for (int i = first; i < last; i++) {
+                    box[chunk].expand((*bounds)[indices[i]]);
+                    centroid_box[chunk].expand(centroids[indices[i]]);
+                }
+            });
+            for (int c = 0; c < chunks; c++) {
+                node.bounds.expand(box[c]);
+                node.centroid_bounds.expand(centroid_box[c]);
+            }
+        }
+
+        // Pedaços em que um nó grande é dividido entre as threads (1 sem pool)
+        int chunk_count(ThreadPool *pool, int count) const {
+            if (!pool || count < parallel_threshold) return 1;
+            return std::min(4 * pool->size(), std::max(1, count / 4096));
+        }
+
+        // Chama work(chunk, first, last) para cada pedaço de [begin, end), no pool se houver.
+        // Só é usada pela thread que constrói os níveis de cima, nunca de dentro de uma tarefa.
+        template <typename Work>
+        static void for_chunks(ThreadPool *pool, int begin, int end, int chunks, Work &&work) {
+            int count = end - begin;
+            if (chunks == 1) {
+                work(0, begin, end);
+                return;
+            }
+            for (int c = 0; c < chunks; c++) {
+                int first = begin + (int) ((long long) count * c / chunks);
+                int last = begin + (int) ((long long) count * (c + 1) / chunks);
+                pool->submit([&work, c, first, last] { work(c, first, last); });
+            }
+            pool->wait();
+        }
+
+        // Copia a árvore de construção para 'nodes': os dois filhos de cada nó ficam lado a lado
+        void flatten(const BuildNode &node, int node_index) {
+            nodes[node_index].bounds = node.bounds;
+            if (!node.children[0]) {
+                make_leaf(node_index, node.begin, node.count);
+                return;
+            }
+            int left_child = (int) nodes.size();
+            nodes.push_back(Node());
+            nodes.push_back(Node());
+            nodes[node_index].first = left_child;
+            nodes[node_index].count = 0;
+            flatten(*node.children[0], left_child);
+            flatten(*node.children[1], left_child + 1);
+        }
+
+        // Acumula em build_stats o custo SAH, a profundidade e os tamanhos das folhas
+        void measure(int node_index, int depth, double root_area) {
+            const Node &node = nodes[node_index];
+            double weight = (root_area > 0)? node.bounds.surface_area() / root_area : 1;
+            build_stats.depth = std::max(build_stats.depth, depth);
+            if (node.is_leaf()) {
+                build_stats.sah_cost += weight * intersection_cost * groups(node.count);
+                if (build_stats.leaves == 0 || node.count < build_stats.smallest_leaf) build_stats.smallest_leaf = node.count;
+                build_stats.largest_leaf = std::max(build_stats.largest_leaf, node.count);
+                build_stats.leaves++;
+                return;
+            }
+            build_stats.sah_cost += weight * traversal_cost;
+            measure(node.first, depth + 1, root_area);
+            measure(node.first + 1, depth + 1, root_area);
+        }
+
+        // Testes de interseção de uma folha com 'count' primitivas
+        inline int groups(int count) const { return (count + leaf_width - 1) / leaf_width; }
+
+        void make_leaf(int node_index, int begin, int count) {
+            nodes[node_index].first = begin;
+            nodes[node_index].count = count;
+        }
+
+        void sort_by_axis(int begin, int end, int axis) {
+            std::sort(indices.begin() + begin, indices.begin() + end, [&](int a, int b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+        }
+};
+
+#endif
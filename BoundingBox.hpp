@@ -0,0 +1,68 @@
+#ifndef BOUNDING_BOX_HPP
+#define BOUNDING_BOX_HPP
+#include "Vector3.hpp"
+#include <math.h>
+#include <algorithm>
+
+// Caixa alinhada aos eixos (AABB), usada pelas estruturas de aceleração
+class BoundingBox {
+    public:
+        Vector3 min;
+        Vector3 max;
+
+        // Caixa vazia: qualquer expand() a substitui
+        BoundingBox(): min {Vector3(INFINITY, INFINITY, INFINITY)}, max {Vector3(-INFINITY, -INFINITY, -INFINITY)} {}
+        BoundingBox(Vector3 min, Vector3 max): min {min}, max {max} {}
+
+        inline void expand(const Vector3 &p) {
+            for (int k = 0; k < 3; k++) {
+                min[k] = std::min(min[k], p[k]);
+                max[k] = std::max(max[k], p[k]);
+            }
+        }
+        inline void expand(const BoundingBox &b) {
+            for (int k = 0; k < 3; k++) {
+                min[k] = std::min(min[k], b.min[k]);
+                max[k] = std::max(max[k], b.max[k]);
+            }
+        }
+
+        inline bool empty() const { return min.x() > max.x(); }
+        inline bool contains(const Vector3 &p) const {
+            return p.x() >= min.x() && p.x() <= max.x() && p.y() >= min.y() && p.y() <= max.y()
+                && p.z() >= min.z() && p.z() <= max.z();
+        }
+        inline Vector3 center() const { return (min + max) * 0.5; }
+        inline Vector3 extent() const { return max - min; }
+
+        inline double surface_area() const {
+            if (empty()) return 0;
+            Vector3 d = extent();
+            return 2 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+        }
+
+        inline int largest_axis() const {
+            Vector3 d = extent();
+            if (d.x() >= d.y() && d.x() >= d.z()) return 0;
+            return (d.y() >= d.z())? 1 : 2;
+        }
+
+        // Teste de slabs. 'inv_dir' é 1/direção, pré-calculado uma vez por raio.
+        // Retorna a distância de entrada em 't_near' se houver interseção em [0, t_max].
+        inline bool hit(const Vector3 &origin, const Vector3 &inv_dir, double t_max, double &t_near) const {
+            double t0 = 0, t1 = t_max;
+            for (int k = 0; k < 3; k++) {
+                double near = (min[k] - origin[k]) * inv_dir[k];
+                double far  = (max[k] - origin[k]) * inv_dir[k];
+                if (near > far) std::swap(near, far);
+                // Comparações escritas de forma que NaN (0 * inf) não restrinja o intervalo
+                t0 = (near > t0)? near : t0;
+                t1 = (far < t1)? far : t1;
+                if (t0 > t1) return false;
+            }
+            t_near = t0;
+            return true;
+        }
+};
+
+#endif
@@ -2,6 +2,17 @@
 #define CAMERA
 #include "Vector3.hpp"
 #include "Object.hpp"
+#include "Scene.hpp"
+#include "ThreadPool.hpp"
+#include "Framebuffer.hpp"
+#include "ImageWriter.hpp"
+#include "RenderStats.hpp"
+#include "Light.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <memory>
 #include <cassert>
 #include <vector>
 
@@ -25,127 +36,999 @@ class Camera {
         Vector3 target;
         Vector3 global_up;
 
-        struct Light {
-            Vector3 position;
-            Color color = WHITE;
-            Light(Vector3 p): position {p} {}
-            Light(double x, double y, double z): position {Vector3(x, y, z)} {}
-            Light() {}
-        };
+        typedef ::Light Light;
 
         std::vector<Light> lights;
         Color ambient_light = WHITE;
         Color bacground_color = BLACK;
 
-        double screen_distance;
+        real screen_distance;
         int screen_height;
         int screen_width;
-        double global_height = 0.9;
-        double global_width = 1.6;
+        real global_height = 0.9;
+        real global_width = 1.6;
+
+        int threads = 1; // 0 usa todos os núcleos disponíveis
+        ThreadPool *pool = nullptr; // pool compartilhado entre câmeras; se dado, 'threads' é ignorado
+        int tile_size = 16;
+        bool ray_packets = false; // traça os raios primários em pacotes de 2x2 pixels
+        // Percorre os pixels de cada bloco na ordem de Morton (curva Z) em vez de por linhas:
+        // raios consecutivos ficam próximos nas duas direções e reaproveitam os mesmos nós
+        // da BVH e triângulos na cache. A imagem é a mesma nas duas ordens.
+        bool morton_order = true;
+        // Motor em frentes de onda: em vez de seguir cada caminho em profundidade, cada bloco
+        // é processado por gerações de raios (os primários, depois os refletidos e refratados
+        // por eles, e assim por diante). Cada geração é agrupada por octante da direção e
+        // traçada em pacotes de 4 raios, e os raios de sombra de todos os seus acertos são
+        // traçados juntos, agrupados por luz. As cores são montadas no fim, das folhas para a
+        // raiz, com as mesmas operações da recursão, e a imagem é a mesma; só com ray_budget,
+        // russian_roulette ou light_samples os sorteios de cada pixel saem em outra ordem
+        // (em largura), com a mesma média.
+        // Não é um modo de desempenho: com uma thread fica mais lento que a recursão em todas
+        // as cenas do benchmark (glass 14,3 contra 11,1 ms, mesh_1024 3,9 contra 2,1 ms,
+        // mesh_16384 4,8 contra 3,7 ms), porque os pacotes de raios secundários são incoerentes
+        // e as filas custam mais do que a pilha da recursão.
+        bool wavefront = false;
+        // Lado dos blocos que render() traça juntos no modo wavefront; blocos maiores reúnem
+        // mais raios por geração. De 16 a 128 nenhum lado alcançou a recursão, e nas cenas de
+        // vidro os maiores pioram (as filas deixam de caber na cache). draw_tile usa tile_size.
+        int wavefront_tile_size = 16;
+
+        // Muitas luzes. Cada ponto sombreado só considera as luzes cujo alcance (Light::range)
+        // o atinge, achadas numa BVH sobre os alcances, reconstruída por render() e relight().
+        // Com light_samples > 0, se mais luzes que isso alcançam o ponto, apenas light_samples
+        // sorteios (com reposição, com probabilidade proporcional à contribuição sem sombra de
+        // cada luz) recebem raios de sombra, e cada um é dividido pela sua probabilidade: a
+        // média é a mesma, trocando o custo por ruído.
+        int light_samples = 0; // 0 = todas as luzes que alcançam o ponto
+        LightTree light_tree;
+
+        // Terminação dos caminhos. Cada raio carrega o peso (throughput) com que sua cor
+        // entra no pixel; um raio secundário cujo peso fica abaixo de min_contribution não
+        // é traçado ou, com russian_roulette, continua com probabilidade proporcional ao
+        // peso e tem a cor compensada (a média fica igual). ray_budget limita os raios de
+        // reflexão e refração traçados por pixel, contando o primário.
+        int max_depth = 5;
+        double min_contribution = 1.0 / 1024;
+        bool russian_roulette = false;
+        int ray_budget = 0; // 0 = sem limite
+
+        // Antisserrilhamento adaptativo. Com aa_samples > 1, depois do quadro com um raio no
+        // centro de cada pixel, os pixels cuja cor difere de um vizinho em mais de aa_threshold
+        // (em algum canal, já limitado a [0, 1]) ou cujo vizinho atingiu outro objeto são
+        // refeitos com uma grade de 2x2 amostras; enquanto as amostras de um pixel ainda
+        // diferirem entre si, a grade dobra de lado até aa_samples x aa_samples. O pixel fica
+        // com a média da última grade. aa_samples = 1 desliga o refinamento.
+        int aa_samples = 1;
+        double aa_threshold = 0.1;
+
+        // Estatísticas. Com collect_stats, render() conta raios e testes de interseção e
+        // guarda o total do quadro em 'stats' e o número de testes de cada pixel em
+        // 'pixel_cost'; draw() imprime o resumo em std::clog e, se heatmap_path não for
+        // vazio, grava ali o mapa de calor do custo por pixel (PPM).
+        bool collect_stats = false;
+        std::string heatmap_path;
+        RenderStats stats;
+        std::vector<uint32_t> pixel_cost;
+
+        // Cache dos acertos primários (G-buffer). Com cache_primary_hits, render() guarda o
+        // acerto do raio primário de cada pixel; relight() sombreia de novo a partir dele sem
+        // traçar a visibilidade primária, o que basta quando só mudam luzes, ambient_light ou
+        // materiais. Mover a câmera ou mudar a resolução invalida o cache; mudanças na
+        // geometria não são detectadas e exigem um render() completo. O G-buffer também é
+        // preenchido com aa_samples > 1, pois o refinamento compara os objetos vizinhos; os
+        // blocos gravam os acertos sempre que render() o alocou.
+        bool cache_primary_hits = false;
+
+        struct GBuffer {
+            std::vector<Object::Intersection> hits; // por pixel, na ordem das linhas da imagem
+            // Parâmetros da câmera com que os acertos foram traçados
+            Vector3 position, target;
+            real screen_distance = 0, global_height = 0, global_width = 0;
+            int width = 0, height = 0;
+
+            void reset(const Camera &camera) {
+                position = camera.position;
+                target = camera.target;
+                screen_distance = camera.screen_distance;
+                global_height = camera.global_height;
+                global_width = camera.global_width;
+                width = camera.screen_width;
+                height = camera.screen_height;
+                hits.assign((size_t) width * height, Object::Intersection());
+            }
+            void clear() { hits.clear(); }
+            bool matches(const Camera &camera) const {
+                return !hits.empty() && position == camera.position && target == camera.target
+                    && screen_distance == camera.screen_distance && global_height == camera.global_height
+                    && global_width == camera.global_width
+                    && width == camera.screen_width && height == camera.screen_height;
+            }
+            Object::Intersection& at(int row, int col) { return hits[(size_t) row * width + col]; }
+        };
+        GBuffer gbuffer;
+
+        // Prazo do quadro. Blocos que ainda não começaram quando ele passa não são
+        // renderizados e render() retorna false, deixando a imagem incompleta; veja
+        // render_progressive, que só publica passos concluídos.
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+        // Passo da renderização progressiva: 1/scale da resolução em cada eixo, a profundidade
+        // de recursão e as amostras de antisserrilhamento usadas
+        struct ProgressivePass {
+            int scale;
+            int depth;
+            int aa_samples;
+        };
+        int progressive_scale = 8; // resolução do primeiro passo: 1/progressive_scale da tela
+
+        // Estado de um caminho: peso acumulado, raios já traçados e o gerador da roleta,
+        // semeado pelo pixel para que a imagem não dependa da ordem dos blocos
+        struct Path {
+            Color throughput = WHITE;
+            int rays = 1;
+            uint64_t seed;
+            Path(uint64_t pixel = 0): seed {pixel * 0x9E3779B97F4A7C15ull + 1} {}
+
+            // Número uniforme em [0, 1) (splitmix64)
+            double random() {
+                uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                z ^= z >> 31;
+                return (z >> 11) * (1.0 / 9007199254740992.0);
+            }
+        };
         
+        // Gerador dos raios primários: a base da câmera e os passos entre pixels são
+        // calculados uma vez por quadro (em begin_frame); cada raio custa então duas somas
+        // de vetores e uma normalização, sem refazer o centro da tela e os tamanhos do pixel.
+        struct PrimaryRays {
+            Vector3 first;    // do olho ao centro do pixel da linha 0 (topo), coluna 0
+            Vector3 row_step; // de uma linha da imagem para a de baixo
+            Vector3 col_step; // de uma coluna para a da direita
+
+            // Direção normalizada do raio que passa pelo pixel (row, col), deslocado de
+            // (d_row, d_col) pixels a partir do seu centro
+            inline Vector3 direction(int row, int col, real d_row = 0, real d_col = 0) const {
+                return (first + row_step * (row + d_row) + col_step * (col + d_col)).normalized();
+            }
+        } primary;
+
+        void setup_primary_rays() {
+            forward = (target - position).normalized();
+            right = global_up.cross(forward);
+            upwards = forward.cross(right).normalized();
+            real pixel_height = global_height / screen_height;
+            real pixel_width = global_width / screen_width;
+            primary.row_step = -upwards * pixel_height;
+            primary.col_step = -right * pixel_width;
+            primary.first = forward * screen_distance
+                          + upwards * ((screen_height - 1) / real(2) * pixel_height)
+                          + right * ((screen_width - 1) / real(2) * pixel_width);
+        }
+
+        // Ponto da tela no centro do pixel (i, j), com i contado de baixo para cima
         Vector3 screen_to_world(int i, int j) {
             assert (i >= 0 && i < screen_height);
             assert (j >= 0 && j < screen_width);
 
             Vector3 screen_center = position + forward * screen_distance;
 
-            double pixel_height = global_height/screen_height;
-            double pixel_width = global_width/screen_width;
+            real pixel_height = global_height/screen_height;
+            real pixel_width = global_width/screen_width;
 
-            Vector3 dh = upwards * (i - (screen_height - 1) / 2) * pixel_height;
-            Vector3 dw = right * ((screen_width)/ 2 - j) * pixel_width;
+            // O centro da tela fica entre os pixels do meio quando a dimensão é par
+            Vector3 dh = upwards * (i - (screen_height - 1) / real(2)) * pixel_height;
+            Vector3 dw = right * ((screen_width - 1) / real(2) - j) * pixel_width;
 
             return screen_center + dh + dw;
         }
-        void draw(std::vector<Object*> objects) {
-            std::cout << "P6\n" << screen_width << " " << screen_height << "\n255\n";
-            for (int i = screen_height-1; i >= 0; i--) {
-                for (int j = 0; j < screen_width; j++) {
-                    Vector3 ray_direction = (screen_to_world(i, j) - position).normalized();
-                    Color pixel_color = get_color(objects, position, ray_direction, 5);
-                    unsigned char
-                        r = static_cast<unsigned char>(std::min(255.0, pixel_color.r() * 255.99)),
-                        g = static_cast<unsigned char>(std::min(255.0, pixel_color.g() * 255.99)),
-                        b = static_cast<unsigned char>(std::min(255.0, pixel_color.b() * 255.99));
-                    std::cout << r << g << b;
+        void draw(const std::vector<Object*> &objects) {
+            draw(Scene(objects));
+        }
+        // Renderiza e grava a imagem em PPM na saída padrão
+        void draw(const Scene &scene) {
+            StreamSink sink(std::cout);
+            draw(scene, sink, ImageFormat::PPM);
+        }
+
+        // Renderiza e grava a imagem em 'sink'; a conversão e a escrita de cada faixa
+        // de linhas acontecem numa thread à parte enquanto o resto ainda é renderizado
+        bool draw(const Scene &scene, ImageSink &sink, ImageFormat format) {
+            Framebuffer image(screen_width, screen_height);
+            ImageWriter writer(image, format, sink);
+            render(scene, image, &writer);
+            bool ok = writer.finish();
+            if (collect_stats && RenderStats::compiled_in) {
+                stats.print(std::clog);
+                if (!heatmap_path.empty() && !write_heatmap(heatmap_path)) {
+                    std::cerr << "Erro ao gravar o mapa de calor " << heatmap_path << std::endl;
                 }
             }
+            return ok;
         }
-        Color get_color(std::vector<Object*> objects, Vector3 p, Vector3 v, int recursions) {
-            double min_dist = INFINITY;
-            Object* hit_obj;
-            Vector3 normal;
-            Color color = BLACK;
-            for (Object* o : objects) {
-                Object::Intersection hit = o->raycast(p, v);
-                double dist = hit.distance;
-                if (dist < min_dist && dist > epsilon) {
-                    min_dist = dist;
-                    hit_obj = hit.object;
+
+        // Grava o custo por pixel do último quadro renderizado com collect_stats
+        bool write_heatmap(const std::string &path) const {
+            Framebuffer heatmap = RenderStats::heatmap(pixel_cost, screen_width, screen_height);
+            FileSink sink(path, ImageWriter::encoded_size(heatmap.width, heatmap.height, ImageFormat::PPM));
+            if (!sink.is_open()) return false;
+            ImageWriter writer(heatmap, ImageFormat::PPM, sink);
+            writer.all_rows_ready();
+            return writer.finish();
+        }
+
+        // Renderiza a radiância de cada pixel em 'image' (que deve ter o tamanho da tela).
+        // Com mais de uma thread a imagem é dividida em blocos de tile_size x tile_size
+        // distribuídos num pool com roubo de tarefas; o resultado é idêntico ao serial.
+        // Se 'writer' for dado, cada faixa de blocos concluída é repassada a ele.
+        // Retorna false se o prazo ('deadline') interrompeu o quadro.
+        bool render(const Scene &scene, Framebuffer &image, ImageWriter *writer = nullptr) {
+            begin_frame();
+            if (cache_primary_hits || aa_samples > 1) gbuffer.reset(*this);
+            else gbuffer.clear();
+            bool complete;
+            if (wavefront) {
+                complete = run_tiles((aa_samples > 1)? nullptr : writer, wavefront_tile_size, [this, &scene, &image](int tx, int ty) {
+                    render_tile_wavefront(scene, image, tx, ty, wavefront_tile_size);
+                });
+            } else {
+                complete = run_tiles((aa_samples > 1)? nullptr : writer, tile_size, [this, &scene, &image](int tx, int ty) { draw_tile(scene, image, tx, ty); });
+            }
+            if (aa_samples > 1 && complete) complete = antialias(scene, image, writer);
+            return complete;
+        }
+
+        // Passos da renderização progressiva: de 1/progressive_scale da resolução com
+        // profundidade 1, dobrando a resolução e somando um nível de recursão a cada passo,
+        // até a tela inteira com max_depth; com aa_samples > 1, um último passo refina os
+        // pixels com o antisserrilhamento adaptativo.
+        std::vector<ProgressivePass> progressive_passes() const {
+            std::vector<ProgressivePass> passes;
+            int depth = 1;
+            for (int scale = std::max(1, progressive_scale); scale > 1; scale /= 2) {
+                passes.push_back({scale, std::min(depth++, max_depth), 1});
+            }
+            passes.push_back({1, max_depth, 1});
+            if (aa_samples > 1) passes.push_back({1, max_depth, aa_samples});
+            return passes;
+        }
+
+        // Renderização progressiva com prazo de 'seconds' segundos: executa os passos de
+        // progressive_passes() em ordem e, a cada passo concluído, amplia o resultado para
+        // 'image' (do tamanho da tela) e chama on_pass(image, passo). Um passo que não
+        // termina no prazo é descartado, então 'image' sempre tem o melhor passo concluído
+        // (e fica intocada se nenhum terminar). Retorna o número de passos concluídos.
+        template <typename OnPass>
+        int render_progressive(const Scene &scene, Framebuffer &image, double seconds, OnPass &&on_pass) {
+            // Os passos alteram a resolução, a profundidade e as amostras; tudo é restaurado no fim
+            const int width = screen_width, height = screen_height, depth = max_depth, samples = aa_samples;
+            const bool cache = cache_primary_hits;
+            const auto previous_deadline = deadline;
+            // Prazos de mais de 1e9 s (ou INFINITY) valem como "sem prazo" sem estourar a conversão
+            deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(std::min(seconds, 1e9)));
+
+            int completed = 0;
+            double last_seconds = 0;
+            for (const ProgressivePass &pass : progressive_passes()) {
+                // Cada passo de resolução tem 4 vezes os pixels do anterior e mais recursão; com
+                // os custos fixos, na prática leva pelo menos o dobro do tempo. Um passo que com
+                // certeza não cabe no prazo nem começa, e o quadro sai antes.
+                auto pass_start = std::chrono::steady_clock::now();
+                double remaining = std::chrono::duration<double>(deadline - pass_start).count();
+                if (remaining <= 0 || (pass.aa_samples == 1 && 2 * last_seconds > remaining)) break;
+                bool complete;
+                if (pass.aa_samples > 1) {
+                    // Refina o último passo, que tem as amostras centrais da tela inteira e o G-buffer
+                    aa_samples = pass.aa_samples;
+                    Framebuffer refined = image;
+                    begin_frame();
+                    complete = antialias(scene, refined);
+                    if (complete) image.pixels.swap(refined.pixels);
+                } else {
+                    screen_width = (width + pass.scale - 1) / pass.scale;
+                    screen_height = (height + pass.scale - 1) / pass.scale;
+                    max_depth = pass.depth;
+                    aa_samples = 1;
+                    // O passo na resolução da tela guarda o G-buffer para o refinamento seguinte
+                    cache_primary_hits = cache || (pass.scale == 1 && samples > 1);
+                    Framebuffer pass_image(screen_width, screen_height);
+                    complete = render(scene, pass_image);
+                    if (complete && pass.scale == 1) image.pixels.swap(pass_image.pixels);
+                    else if (complete) upscale(pass_image, image);
+                }
+                screen_width = width;
+                screen_height = height;
+                max_depth = depth;
+                aa_samples = samples;
+                cache_primary_hits = cache;
+                if (!complete) break;
+                last_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pass_start).count();
+                completed++;
+                on_pass(static_cast<const Framebuffer&>(image), pass);
+            }
+            deadline = previous_deadline;
+            return completed;
+        }
+        int render_progressive(const Scene &scene, Framebuffer &image, double seconds) {
+            return render_progressive(scene, image, seconds, [](const Framebuffer&, const ProgressivePass&) {});
+        }
+
+        // Amplia 'small' para 'image' repetindo cada pixel no bloco da tela que ele cobre
+        static void upscale(const Framebuffer &small, Framebuffer &image) {
+            for (int row = 0; row < image.height; row++) {
+                int small_row = (int) (((int64_t) row * small.height) / image.height);
+                for (int col = 0; col < image.width; col++) {
+                    image.at(row, col) = small.at(small_row, (int) (((int64_t) col * small.width) / image.width));
                 }
             }
-            if (min_dist == INFINITY) return color;
-            v = v.normalized();
-            Vector3 hit_point = p + v*min_dist;
-            normal = hit_obj->get_normal(hit_point);
-            Object::Material *material = hit_obj->material;
+        }
 
-            // Como a reflexão é ortogonal, preferi calcular a reflexão da visão em n e então o cosseno com a direção da luz
-            Vector3 reflected = reflection_vector(-v, normal);
-
-            for (auto l : lights) {
-                Vector3 light_direction = (l.position - hit_point).normalized();
-                bool blocked = false;
-                for (Object* o : objects) {
-                    if (hit_obj == o) continue;
-                    Object::Intersection obst = o->raycast(hit_point, light_direction);
-                    double distance = obst.distance;
-                    if(distance != INFINITY && distance > epsilon) {
-                        blocked = true;
-                        break;
+        // Sombreia 'image' de novo a partir do G-buffer do último render(), refazendo os raios
+        // de sombra e os secundários mas não os primários. Se 'changed' for dado, só os pixels
+        // que podem depender desse material são refeitos e os demais mantêm o valor que já têm
+        // em 'image', que deve ser o quadro anterior (com aa_samples > 1 todos são refeitos,
+        // já que 'image' guarda as médias e não as amostras centrais). Sem um cache válido
+        // para a câmera atual, faz um render() completo e retorna false; também retorna false
+        // se o prazo ('deadline') interrompeu o quadro.
+        bool relight(const Scene &scene, Framebuffer &image, const Object::Material *changed = nullptr,
+                     ImageWriter *writer = nullptr) {
+            if (!gbuffer.matches(*this)) {
+                render(scene, image, writer);
+                return false;
+            }
+            begin_frame();
+            if (aa_samples > 1) changed = nullptr;
+            bool complete = run_tiles((aa_samples > 1)? nullptr : writer, tile_size,
+                                      [this, &scene, &image, changed](int tx, int ty) { relight_tile(scene, image, tx, ty, changed); });
+            if (aa_samples > 1 && complete) complete = antialias(scene, image, writer);
+            return complete;
+        }
+
+        // Passo de refinamento sobre o quadro de amostras centrais em 'image'; false se o prazo o interrompeu
+        bool antialias(const Scene &scene, Framebuffer &image, ImageWriter *writer = nullptr) {
+            const Framebuffer centers = image;
+            return run_tiles(writer, tile_size, [this, &scene, &centers, &image](int tx, int ty) { antialias_tile(scene, centers, image, tx, ty); });
+        }
+
+        // Prepara um quadro: calcula o gerador de raios primários, reconstrói a árvore de luzes e zera as estatísticas, nas quais
+        // cada passo de run_tiles soma. Quem chama draw_tile diretamente deve chamá-la antes.
+        void begin_frame() {
+            setup_primary_rays();
+            light_tree.build(lights);
+            stats = RenderStats();
+            if (collect_stats && RenderStats::compiled_in) pixel_cost.assign((size_t) screen_width * screen_height, 0);
+            else pixel_cost.clear();
+        }
+
+        // Executa 'tile(tx, ty)' em todos os blocos de 'side' x 'side' pixels da tela, em série
+        // ou no pool, e soma os contadores dos blocos em stats. Retorna false se algum bloco
+        // foi pulado por ter começado depois do prazo.
+        template <typename Tile>
+        bool run_tiles(ImageWriter *writer, int side, Tile &&tile) {
+            int tiles_y = (screen_height + side - 1) / side;
+            int tiles_x = (screen_width + side - 1) / side;
+            int thread_count = (threads > 0)? threads : ThreadPool::default_thread_count();
+
+            // Blocos restantes em cada faixa; quando chega a zero, as linhas da faixa estão prontas
+            std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[tiles_y]);
+            for (int ty = 0; ty < tiles_y; ty++) remaining[ty] = tiles_x;
+
+            // Cada bloco conta nos seus próprios contadores; a soma é feita no fim
+            auto start = std::chrono::steady_clock::now();
+            bool counting = collect_stats && RenderStats::compiled_in;
+            std::vector<RenderStats> tile_stats(counting? tiles_x * tiles_y : 0);
+
+            // Depois do prazo os blocos restantes só passam adiante, sem renderizar
+            const bool timed = deadline != std::chrono::steady_clock::time_point::max();
+            std::atomic<bool> expired {false};
+
+            auto run_tile = [this, &tile, writer, side, &remaining, &tile_stats, counting, tiles_x, timed, &expired](int tx, int ty) {
+                if (timed && !expired && std::chrono::steady_clock::now() >= deadline) expired = true;
+                if (!expired) {
+                    if (counting) RenderStats::local() = &tile_stats[ty * tiles_x + tx];
+                    tile(tx, ty);
+                    RenderStats::local() = nullptr;
+                }
+                if (--remaining[ty] == 0 && writer) {
+                    int first = ty * side;
+                    writer->rows_ready(first, std::min(side, screen_height - first));
+                }
+            };
+
+            if (pool) {
+                ThreadPool::Group group(*pool);
+                for (int ty = 0; ty < tiles_y; ty++)
+                    for (int tx = 0; tx < tiles_x; tx++)
+                        group.submit([&run_tile, tx, ty] { run_tile(tx, ty); });
+                group.wait();
+            } else if (thread_count == 1) {
+                for (int ty = 0; ty < tiles_y; ty++)
+                    for (int tx = 0; tx < tiles_x; tx++)
+                        run_tile(tx, ty);
+            } else {
+                ThreadPool frame_pool(thread_count);
+                for (int ty = 0; ty < tiles_y; ty++)
+                    for (int tx = 0; tx < tiles_x; tx++)
+                        frame_pool.submit([&run_tile, tx, ty] { run_tile(tx, ty); });
+                frame_pool.wait();
+            }
+
+            for (const RenderStats &t : tile_stats) stats += t;
+            stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return !expired;
+        }
+
+        // Testes de interseção feitos até agora no bloco atual (0 sem coleta)
+        static uint64_t tests_so_far() {
+            RenderStats *s = RenderStats::local();
+            return s? s->tests() : 0;
+        }
+
+        // Chama f(row, col) para cada pixel do bloco (tx, ty) de 'side' x 'side' pixels ou, com
+        // step = 2, para o canto superior esquerdo de cada quadrado 2x2, em ordem de Morton ou por linhas
+        template <typename F>
+        void for_each_pixel(int tx, int ty, int side, int step, F &&f) const {
+            int row_begin = ty * side, col_begin = tx * side;
+            int row_end = std::min(screen_height, row_begin + side);
+            int col_end = std::min(screen_width, col_begin + side);
+            if (!morton_order) {
+                for (int row = row_begin; row < row_end; row += step)
+                    for (int col = col_begin; col < col_end; col += step)
+                        f(row, col);
+                return;
+            }
+            int cells = (side + step - 1) / step, morton_side = 1;
+            while (morton_side < cells) morton_side *= 2;
+            for (uint32_t k = 0; k < (uint32_t) morton_side * morton_side; k++) {
+                int row = row_begin + morton_coordinate(k >> 1) * step;
+                int col = col_begin + morton_coordinate(k) * step;
+                if (row < row_end && col < col_end) f(row, col);
+            }
+        }
+
+        // Junta os bits pares de 'k': a coordenada x do índice k na curva de Morton (y com k >> 1)
+        static inline int morton_coordinate(uint32_t k) {
+            k &= 0x55555555;
+            k = (k ^ (k >> 1)) & 0x33333333;
+            k = (k ^ (k >> 2)) & 0x0F0F0F0F;
+            k = (k ^ (k >> 4)) & 0x00FF00FF;
+            k = (k ^ (k >> 8)) & 0x0000FFFF;
+            return (int) k;
+        }
+
+        void draw_tile(const Scene &scene, Framebuffer &image, int tx, int ty) {
+            if (wavefront) render_tile_wavefront(scene, image, tx, ty, tile_size);
+            else if (ray_packets) render_tile_packets(scene, image, tx, ty);
+            else render_tile(scene, image, tx, ty);
+        }
+
+        void render_tile(const Scene &scene, Framebuffer &image, int tx, int ty) {
+            for_each_pixel(tx, ty, tile_size, 1, [&](int row, int j) {
+                uint64_t tests = tests_so_far();
+                RT_STAT(primary_rays, 1);
+                Vector3 ray_direction = primary.direction(row, j);
+                Object::Intersection hit = scene.raycast(position, ray_direction);
+                if (!gbuffer.hits.empty()) gbuffer.at(row, j) = hit;
+                Path path((uint64_t) row * screen_width + j);
+                image.at(row, j) = shade(scene, position, ray_direction, hit, max_depth, path);
+                if (!pixel_cost.empty()) pixel_cost[(size_t) row * screen_width + j] = (uint32_t) (tests_so_far() - tests);
+            });
+        }
+
+        // Mesmo resultado de render_tile, mas os raios primários de cada bloco 2x2
+        // são traçados juntos como um pacote; o sombreamento continua por raio.
+        void render_tile_packets(const Scene &scene, Framebuffer &image, int tx, int ty) {
+            int row_end = std::min(screen_height, (ty + 1) * tile_size);
+            int col_end = std::min(screen_width, (tx + 1) * tile_size);
+            for_each_pixel(tx, ty, tile_size, 2, [&](int row, int col) {
+                RayPacket4 packet;
+                Vector3 directions[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    int r = row + lane / 2, j = col + lane % 2;
+                    if (r >= row_end || j >= col_end) continue;
+                    directions[lane] = primary.direction(r, j);
+                    packet.set(lane, position, directions[lane]);
+                }
+                Object::Intersection hits[4];
+                uint64_t tests = tests_so_far();
+                RT_STAT(primary_rays, lane_count(packet.active));
+                scene.raycast_packet(packet, hits);
+                // O custo do pacote é dividido igualmente entre as faixas
+                uint64_t packet_cost = (tests_so_far() - tests) / lane_count(packet.active);
+                for (int lane = 0; lane < 4; lane++) {
+                    if (!(packet.active & (1 << lane))) continue;
+                    int r = row + lane / 2, j = col + lane % 2;
+                    tests = tests_so_far();
+                    if (!gbuffer.hits.empty()) gbuffer.at(r, j) = hits[lane];
+                    Path path((uint64_t) r * screen_width + j);
+                    image.at(r, j) = shade(scene, position, directions[lane], hits[lane], max_depth, path);
+                    if (!pixel_cost.empty()) pixel_cost[(size_t) r * screen_width + j] = (uint32_t) (packet_cost + tests_so_far() - tests);
+                }
+            });
+        }
+
+        // Refaz o sombreamento do bloco a partir dos acertos do G-buffer. O mesmo Path
+        // semeado pelo pixel garante a mesma imagem de render() quando nada mudou.
+        void relight_tile(const Scene &scene, Framebuffer &image, int tx, int ty, const Object::Material *changed) {
+            for_each_pixel(tx, ty, tile_size, 1, [&](int row, int j) {
+                const Object::Intersection &hit = gbuffer.at(row, j);
+                if (changed && !depends_on(hit, changed)) return;
+                uint64_t tests = tests_so_far();
+                Vector3 ray_direction = primary.direction(row, j);
+                Path path((uint64_t) row * screen_width + j);
+                image.at(row, j) = shade(scene, position, ray_direction, hit, max_depth, path);
+                if (!pixel_cost.empty()) pixel_cost[(size_t) row * screen_width + j] = (uint32_t) (tests_so_far() - tests);
+            });
+        }
+
+        // Refina os pixels do bloco que contrastam com algum vizinho em 'centers' (o quadro
+        // de amostras centrais) e grava as médias em 'image'
+        void antialias_tile(const Scene &scene, const Framebuffer &centers, Framebuffer &image, int tx, int ty) {
+            for_each_pixel(tx, ty, tile_size, 1, [&](int row, int j) {
+                if (!needs_refinement(centers, row, j)) return;
+                uint64_t tests = tests_so_far();
+                RT_STAT(refined_pixels, 1);
+                image.at(row, j) = supersample(scene, row, j);
+                if (!pixel_cost.empty()) pixel_cost[(size_t) row * screen_width + j] += (uint32_t) (tests_so_far() - tests);
+            });
+        }
+
+        bool needs_refinement(const Framebuffer &centers, int row, int col) {
+            static const int offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+            const Color &c = centers.at(row, col);
+            const Object *object = gbuffer.at(row, col).object;
+            for (auto &o : offsets) {
+                int r = row + o[0], j = col + o[1];
+                if (r < 0 || r >= screen_height || j < 0 || j >= screen_width) continue;
+                if (gbuffer.at(r, j).object != object || contrast(c, centers.at(r, j)) > aa_threshold) return true;
+            }
+            return false;
+        }
+
+        // Maior diferença entre os canais das duas cores, limitadas a [0, 1] como na saída
+        static double contrast(const Color &a, const Color &b) {
+            double d = 0;
+            for (int c = 0; c < 3; c++) d = std::max(d, (double) fabs(std::min(a[c], real(1)) - std::min(b[c], real(1))));
+            return d;
+        }
+
+        // Média de grades n x n de amostras no pixel, com n = 2, 4, ... até aa_samples,
+        // parando na primeira grade cujas amostras concordam entre si
+        Color supersample(const Scene &scene, int row, int col) {
+            uint64_t pixel = (uint64_t) row * screen_width + col;
+            for (int n = 2; ; n *= 2) {
+                n = std::min(n, aa_samples);
+                Color sum = BLACK, low(INFINITY, INFINITY, INFINITY), high(-INFINITY, -INFINITY, -INFINITY);
+                const Object *first = nullptr;
+                bool same_object = true;
+                for (int a = 0; a < n; a++) {
+                    for (int b = 0; b < n; b++) {
+                        RT_STAT(primary_rays, 1);
+                        real d_row = (2 * a + 1 - n) / (2 * real(n)), d_col = (2 * b + 1 - n) / (2 * real(n));
+                        Vector3 direction = primary.direction(row, col, d_row, d_col);
+                        Object::Intersection hit = scene.raycast(position, direction);
+                        // Semente distinta da amostra central e das outras amostras do pixel
+                        Path path(pixel + ((uint64_t) (n * n + a * n + b) << 40));
+                        Color sample = shade(scene, position, direction, hit, max_depth, path);
+                        sum += sample;
+                        for (int c = 0; c < 3; c++) {
+                            real v = std::min(sample[c], real(1));
+                            low[c] = std::min(low[c], v);
+                            high[c] = std::max(high[c], v);
+                        }
+                        if (a == 0 && b == 0) first = hit.object;
+                        else same_object = same_object && hit.object == first;
                     }
                 }
-                if (blocked) continue;
-
-                double cos_theta = (light_direction).dot(normal);
-                if (cos_theta <= 0) cos_theta = 0;
-                // Difusa
-                else color += (l.color * material->diffuse) * cos_theta;
-
-                double cos_alpha = reflected.dot(light_direction);
-                if (cos_alpha <= 0) continue;
-                
-                cos_alpha = pow(cos_alpha, material->ns);
-                // Especular
-                color += (l.color * material->specular) * cos_alpha;
-            }
-            color += ambient_light * material->ambient;
-            color *= material->opacity;
-            if (!(material->specular == BLACK) && recursions > 0) {
-                // std::clog << normal <<"\n";
-                //hit_point += (normal * epsilon);
-                color += material->specular * get_color(objects, hit_point + normal * epsilon, reflected, recursions-1);
+                if (n >= aa_samples || (same_object && contrast(low, high) <= aa_threshold)) return sum * (real) (1.0 / (n * n));
+            }
+        }
+
+        // Verdadeiro se a cor do pixel com acerto primário 'hit' pode depender de 'material'.
+        // Os raios de sombra não olham materiais, então só o material do acerto primário e,
+        // se ele refletir ou transmitir, o que os raios secundários encontrarem importam.
+        bool depends_on(const Object::Intersection &hit, const Object::Material *material) const {
+            if (hit.distance == INFINITY) return false;
+            if (hit.material == material) return true;
+            return max_depth > 0 && (!(hit.material->specular == BLACK) || hit.material->opacity < 1);
+        }
+
+        Color get_color(const Scene &scene, Vector3 p, Vector3 v, int recursions) {
+            Path path;
+            return get_color(scene, p, v, recursions, path);
+        }
+        Color get_color(const Scene &scene, Vector3 p, Vector3 v, int recursions, Path &path) {
+            return shade(scene, p, v, scene.raycast(p, v), recursions, path);
+        }
+        // Ponto atingido por um raio e as direções que o sombreamento deriva dele
+        struct Surface {
+            Vector3 v;         // direção do raio, normalizada
+            Vector3 point;
+            Vector3 normal;
+            Vector3 reflected; // reflexão da visão em torno da normal
+            const Object::Material *material;
+        };
+
+        Surface surface(const Vector3 &p, const Vector3 &v, const Object::Intersection &hit) const {
+            Surface s;
+            s.v = v.normalized();
+            s.point = p + s.v*hit.distance;
+            s.normal = hit.normal;
+            s.material = hit.material;
+            // Como a reflexão é ortogonal, preferi calcular a reflexão da visão em n e então o cosseno com a direção da luz
+            s.reflected = reflection_vector(-s.v, s.normal);
+            return s;
+        }
+
+        // Cor local do ponto (luzes e ambiente, vezes a opacidade). 'visible(i, direção,
+        // distância)' diz se a luz i é vista do ponto; é chamada só para luzes que o alcançam,
+        // na ordem de light_tree.visit. No modo light_samples os raios de sombra são traçados aqui.
+        template <typename Visible>
+        Color local_color(const Scene &scene, const Surface &s, Path &path, Visible &&visible) {
+            Color color = BLACK;
+            if (light_samples > 0) sample_lights(scene, s.point, s.normal, s.reflected, s.material, path, color);
+            else light_tree.visit(s.point, [&](int i) {
+                add_light(lights[i], s.point, s.normal, s.reflected, s.material, color,
+                          [&](const Vector3 &direction, real distance) { return visible(i, direction, distance); });
+            });
+            color += ambient_light * s.material->ambient;
+            color *= s.material->opacity;
+            return color;
+        }
+
+        // Origem e direção do raio refratado em 's'
+        void refraction_ray(const Surface &s, Vector3 &origin, Vector3 &direction) const {
+            Vector3 N = s.normal;
+            real n_it;
+            if (N.dot(s.v) < 0) {
+                n_it = 1.0/s.material->ni;
+            } else {
+                n_it = s.material->ni;
+                N = -N;
+            }
+            direction = refraction_vector(-s.v, N, n_it);
+            origin = s.point - epsilon * N;
+        }
+
+        // Sombreia o acerto 'hit' do raio (p, v), que já foi traçado
+        Color shade(const Scene &scene, Vector3 p, Vector3 v, const Object::Intersection &hit, int recursions, Path &path) {
+            if (hit.distance == INFINITY) return BLACK;
+            Surface s = surface(p, v, hit);
+            const Object::Material *material = s.material;
+            Color color = local_color(scene, s, path, [&](int, const Vector3 &direction, real distance) {
+                return light_visible(scene, s.point, s.normal, direction, distance);
+            });
+            if (recursions <= 0) return color;
+
+            double scale;
+            const Color throughput = path.throughput;
+            if (!(material->specular == BLACK) && continue_path(throughput * material->specular, path, scale)) {
+                RT_STAT(reflection_rays, 1);
+                Color reflection = material->specular * get_color(scene, s.point + s.normal * epsilon, s.reflected, recursions-1, path);
+                color += (scale == 1)? reflection : reflection * scale;
+                path.throughput = throughput;
             }
             
-            if (material->opacity < 1) {
-                //std::clog << "opacity: " << material->opacity << "\n";
-                Vector3 N = normal;
-                double n_it;
-                if (N.dot(v) < 0) {
-                    n_it = 1.0/material->ni;
-                } else {
-                    n_it = material->ni;
-                    N = -N;
-                }
-                Vector3 refracted = refraction_vector(-v, N, n_it);
-                color += std::max(0.0, 1 - material->opacity) * get_color(objects, hit_point - epsilon * N, refracted, recursions-1);
+            real transmittance = std::max(real(0), 1 - material->opacity);
+            if (material->opacity < 1 && continue_path(throughput * transmittance, path, scale)) {
+                RT_STAT(refraction_rays, 1);
+                Vector3 origin, refracted;
+                refraction_ray(s, origin, refracted);
+                Color refraction = get_color(scene, origin, refracted, recursions-1, path) * transmittance;
+                color += (scale == 1)? refraction : refraction * scale;
+                path.throughput = throughput;
             }
             return color;
         }
-        inline const Vector3 refraction_vector(const Vector3 &I, Vector3 &N, double n_it) const {
-            const double &cos_i = N.dot(I);
-            const double &sqrsin_i = 1 - cos_i*cos_i;
-            const double &k = 1 - (n_it*n_it) * sqrsin_i;
+
+        // Raio do motor em frentes de onda: um nó da árvore de raios de um pixel
+        struct WaveRay {
+            Vector3 origin, direction;
+            int pixel;          // índice do pixel no bloco
+            int depth;          // recursões restantes
+            Color throughput;   // peso com que a cor do raio entra no pixel
+            Object::Intersection hit;
+            Color color = BLACK; // cor local; depois da montagem, a cor completa
+            int reflection = -1, refraction = -1; // índices dos raios filhos
+            double reflection_scale = 1, refraction_scale = 1;
+            real transmittance = 0;
+        };
+
+        struct ShadowRay {
+            Vector3 origin, direction;
+            real distance;
+            int light;
+        };
+
+        // Filas do motor em frentes de onda, reaproveitadas entre os blocos de cada thread
+        struct WaveQueues {
+            std::vector<std::pair<int, int>> pixels; // (linha, coluna) de cada pixel do bloco
+            std::vector<Path> paths;
+            std::vector<WaveRay> rays;
+            std::vector<int> wave, next;
+            std::vector<Surface> surfaces;
+            std::vector<ShadowRay> shadows;
+            std::vector<char> visible;
+            std::vector<int> sorted, order, first;
+        };
+
+        // Bloco (tx, ty) de 'side' x 'side' pixels em frentes de onda
+        void render_tile_wavefront(const Scene &scene, Framebuffer &image, int tx, int ty, int side) {
+            uint64_t tile_tests = tests_so_far();
+            static thread_local WaveQueues queues;
+            auto &pixels = queues.pixels;
+            auto &paths = queues.paths;
+            auto &rays = queues.rays;
+            auto &wave = queues.wave;
+            auto &next = queues.next;
+            auto &surfaces = queues.surfaces;
+            auto &shadows = queues.shadows;
+            auto &visible = queues.visible;
+            pixels.clear();
+            paths.clear();
+            rays.clear();
+            wave.clear();
+            for_each_pixel(tx, ty, side, 1, [&](int row, int col) {
+                WaveRay ray;
+                ray.origin = position;
+                ray.direction = primary.direction(row, col);
+                ray.pixel = (int) pixels.size();
+                ray.depth = max_depth;
+                ray.throughput = WHITE;
+                wave.push_back((int) rays.size());
+                rays.push_back(ray);
+                pixels.push_back({row, col});
+                paths.emplace_back((uint64_t) row * screen_width + col);
+            });
+            RT_STAT(primary_rays, wave.size());
+
+            for (bool primary_wave = true; !wave.empty(); primary_wave = false) {
+                if (!primary_wave) sort_wave(rays, wave, queues.sorted);
+                trace_wave(scene, rays, wave);
+                if (primary_wave && !gbuffer.hits.empty()) {
+                    for (int r : wave) gbuffer.at(pixels[rays[r].pixel].first, pixels[rays[r].pixel].second) = rays[r].hit;
+                }
+
+                // Pontos atingidos e, fora do modo light_samples, os raios de sombra de todos
+                // eles, na mesma ordem em que local_color vai consultá-los
+                if (surfaces.size() < wave.size()) surfaces.resize(wave.size());
+                shadows.clear();
+                for (size_t k = 0; k < wave.size(); k++) {
+                    const WaveRay &ray = rays[wave[k]];
+                    if (ray.hit.distance == INFINITY) continue;
+                    const Surface &s = surfaces[k] = surface(ray.origin, ray.direction, ray.hit);
+                    if (light_samples > 0) continue;
+                    light_tree.visit(s.point, [&](int i) {
+                        Vector3 to_light = lights[i].position - s.point;
+                        real light_distance = to_light.length();
+                        Vector3 light_direction = to_light / light_distance;
+                        if (lights[i].falloff(light_distance) <= 0) return;
+                        shadows.push_back({shadow_origin(s.point, s.normal, light_direction), light_direction, light_distance, i});
+                    });
+                }
+                trace_shadows(scene, queues);
+
+                // Sombreamento local e a próxima geração
+                next.clear();
+                size_t cursor = 0;
+                for (size_t k = 0; k < wave.size(); k++) {
+                    int index = wave[k];
+                    if (rays[index].hit.distance == INFINITY) continue;
+                    const Surface &s = surfaces[k];
+                    Path &path = paths[rays[index].pixel];
+                    const Color throughput = rays[index].throughput;
+                    path.throughput = throughput;
+                    rays[index].color = local_color(scene, s, path, [&](int, const Vector3&, real) { return visible[cursor++] != 0; });
+                    if (rays[index].depth <= 0) continue;
+
+                    WaveRay child;
+                    child.pixel = rays[index].pixel;
+                    child.depth = rays[index].depth - 1;
+                    double scale;
+                    if (!(s.material->specular == BLACK) && continue_path(throughput * s.material->specular, path, scale)) {
+                        RT_STAT(reflection_rays, 1);
+                        child.origin = s.point + s.normal * epsilon;
+                        child.direction = s.reflected;
+                        child.throughput = path.throughput;
+                        rays[index].reflection = (int) rays.size();
+                        rays[index].reflection_scale = scale;
+                        next.push_back((int) rays.size());
+                        rays.push_back(child);
+                        path.throughput = throughput;
+                    }
+                    real transmittance = std::max(real(0), 1 - s.material->opacity);
+                    if (s.material->opacity < 1 && continue_path(throughput * transmittance, path, scale)) {
+                        RT_STAT(refraction_rays, 1);
+                        refraction_ray(s, child.origin, child.direction);
+                        child.throughput = path.throughput;
+                        rays[index].refraction = (int) rays.size();
+                        rays[index].refraction_scale = scale;
+                        rays[index].transmittance = transmittance;
+                        next.push_back((int) rays.size());
+                        rays.push_back(child);
+                        path.throughput = throughput;
+                    }
+                }
+                wave.swap(next);
+            }
+
+            // Montagem das cores: os filhos vêm depois dos pais no vetor
+            for (int i = (int) rays.size() - 1; i >= 0; i--) {
+                WaveRay &ray = rays[i];
+                if (ray.reflection >= 0) {
+                    Color reflection = ray.hit.material->specular * rays[ray.reflection].color;
+                    ray.color += (ray.reflection_scale == 1)? reflection : reflection * ray.reflection_scale;
+                }
+                if (ray.refraction >= 0) {
+                    Color refraction = rays[ray.refraction].color * ray.transmittance;
+                    ray.color += (ray.refraction_scale == 1)? refraction : refraction * ray.refraction_scale;
+                }
+            }
+            for (size_t p = 0; p < pixels.size(); p++) image.at(pixels[p].first, pixels[p].second) = rays[p].color;
+
+            // Os raios do bloco são traçados juntos; o custo é dividido igualmente entre os pixels
+            if (!pixel_cost.empty() && !pixels.empty()) {
+                uint32_t cost = (uint32_t) ((tests_so_far() - tile_tests) / pixels.size());
+                for (auto &p : pixels) pixel_cost[(size_t) p.first * screen_width + p.second] = cost;
+            }
+        }
+
+        // Traça os raios da geração em pacotes de 4, na ordem de 'wave'
+        void trace_wave(const Scene &scene, std::vector<WaveRay> &rays, const std::vector<int> &wave) const {
+            for (size_t k = 0; k < wave.size(); k += 4) {
+                int n = (int) std::min<size_t>(4, wave.size() - k);
+                RayPacket4 packet;
+                for (int lane = 0; lane < n; lane++) packet.set(lane, rays[wave[k + lane]].origin, rays[wave[k + lane]].direction);
+                Object::Intersection hits[4];
+                scene.raycast_packet(packet, hits);
+                for (int lane = 0; lane < n; lane++) rays[wave[k + lane]].hit = hits[lane];
+            }
+        }
+
+        // Agrupa a geração pelo octante da direção, para que os raios de um pacote visitem
+        // os nós da BVH na mesma ordem. A ordenação por contagem é estável: dentro de cada
+        // octante os raios seguem a ordem de Morton dos pixels do bloco, e com ela a
+        // proximidade das origens.
+        static void sort_wave(const std::vector<WaveRay> &rays, std::vector<int> &wave, std::vector<int> &sorted) {
+            int first[9] = {0};
+            auto octant = [&](int r) {
+                const Vector3 &d = rays[r].direction;
+                return (d.x() < 0) | (d.y() < 0) << 1 | (d.z() < 0) << 2;
+            };
+            for (int r : wave) first[octant(r) + 1]++;
+            for (int o = 1; o < 9; o++) first[o] += first[o - 1];
+            sorted.resize(wave.size());
+            for (int r : wave) sorted[first[octant(r)]++] = r;
+            wave.swap(sorted);
+        }
+
+        // Traça os raios de sombra agrupados por luz (ordenação por contagem);
+        // queues.visible[i] diz se queues.shadows[i] chega à luz
+        void trace_shadows(const Scene &scene, WaveQueues &queues) const {
+            const auto &shadows = queues.shadows;
+            auto &visible = queues.visible;
+            auto &order = queues.order;
+            auto &first = queues.first;
+            visible.assign(shadows.size(), 0);
+            order.resize(shadows.size());
+            if (lights.size() <= 1) {
+                for (size_t i = 0; i < order.size(); i++) order[i] = (int) i;
+            } else {
+                first.assign(lights.size() + 1, 0);
+                for (const ShadowRay &r : shadows) first[r.light + 1]++;
+                for (size_t l = 1; l < first.size(); l++) first[l] += first[l - 1];
+                for (size_t i = 0; i < shadows.size(); i++) order[first[shadows[i].light]++] = (int) i;
+            }
+            for (int i : order) {
+                RT_STAT(shadow_rays, 1);
+                visible[i] = !scene.occluded(shadows[i].origin, shadows[i].direction, shadows[i].distance);
+            }
+        }
+
+        // Soma em 'color' a contribuição difusa e especular da luz 'l' em 'hit_point' e
+        // retorna false se ela não ilumina o ponto: fora do alcance ou, segundo
+        // 'visible(direção, distância)', bloqueada.
+        template <typename Visible>
+        bool add_light(const Light &l, const Vector3 &hit_point, const Vector3 &normal, const Vector3 &reflected,
+                       const Object::Material *material, Color &color, Visible &&visible) {
+            Vector3 to_light = l.position - hit_point;
+            real light_distance = to_light.length();
+            Vector3 light_direction = to_light / light_distance;
+            real falloff = l.falloff(light_distance);
+            if (falloff <= 0) return false;
+            if (!visible(light_direction, light_distance)) return false;
+            Color light_color = l.bounded()? l.color * falloff : l.color;
+
+            real cos_theta = (light_direction).dot(normal);
+            if (cos_theta <= 0) cos_theta = 0;
+            // Difusa
+            else color += (light_color * material->diffuse) * cos_theta;
+
+            real cos_alpha = reflected.dot(light_direction);
+            if (cos_alpha <= 0) return true;
+
+            cos_alpha = pow(cos_alpha, material->ns);
+            // Especular
+            color += (light_color * material->specular) * cos_alpha;
+            return true;
+        }
+
+        // Raio de sombra. Ele parte um pouco acima da superfície, do lado da luz, e só conta
+        // o que estiver antes dela; assim o próprio objeto também pode fazer sombra.
+        static Vector3 shadow_origin(const Vector3 &hit_point, const Vector3 &normal, const Vector3 &light_direction) {
+            return hit_point + normal * ((normal.dot(light_direction) >= 0)? epsilon : -epsilon);
+        }
+        bool light_visible(const Scene &scene, const Vector3 &hit_point, const Vector3 &normal,
+                           const Vector3 &light_direction, real light_distance) const {
+            RT_STAT(shadow_rays, 1);
+            return !scene.occluded(shadow_origin(hit_point, normal, light_direction), light_direction, light_distance);
+        }
+
+        // Iluminação direta estimada com light_samples raios de sombra (veja light_samples)
+        void sample_lights(const Scene &scene, const Vector3 &hit_point, const Vector3 &normal, const Vector3 &reflected,
+                           const Object::Material *material, Path &path, Color &color) {
+            // Luzes candidatas com a contribuição sem sombra e a soma acumulada dos pesos;
+            // o vetor é reaproveitado (o sombreamento das luzes não é reentrante)
+            struct Candidate { int light; Color contribution; double cumulative; };
+            static thread_local std::vector<Candidate> candidates;
+            candidates.clear();
+            double total = 0;
+            light_tree.visit(hit_point, [&](int i) {
+                Color c = BLACK;
+                if (!add_light(lights[i], hit_point, normal, reflected, material, c, [](const Vector3&, real) { return true; })) return;
+                double weight = c.r() + c.g() + c.b();
+                if (weight <= 0) return;
+                total += weight;
+                candidates.push_back({i, c, total});
+            });
+            if ((int) candidates.size() <= light_samples) {
+                for (const Candidate &c : candidates) {
+                    add_light(lights[c.light], hit_point, normal, reflected, material, color, [&](const Vector3 &direction, real distance) {
+                        return light_visible(scene, hit_point, normal, direction, distance);
+                    });
+                }
+                return;
+            }
+            for (int s = 0; s < light_samples; s++) {
+                double u = path.random() * total;
+                auto it = std::upper_bound(candidates.begin(), candidates.end(), u,
+                                           [](double value, const Candidate &c) { return value < c.cumulative; });
+                if (it == candidates.end()) --it;
+                double weight = it->cumulative - ((it == candidates.begin())? 0 : (it - 1)->cumulative);
+                const Light &l = lights[it->light];
+                Vector3 to_light = l.position - hit_point;
+                real light_distance = to_light.length();
+                Vector3 light_direction = to_light / light_distance;
+                if (!light_visible(scene, hit_point, normal, light_direction, light_distance)) continue;
+                // Probabilidade do sorteio: weight / total, e light_samples sorteios
+                color += it->contribution * (real) (total / (weight * light_samples));
+            }
+        }
+
+        // Decide se um raio secundário com peso 'weight' é traçado. Se for, o peso passa a
+        // ser o do caminho e 'scale' recebe a compensação da roleta russa (1 sem ela).
+        bool continue_path(const Color &weight, Path &path, double &scale) {
+            scale = 1;
+            if (ray_budget > 0 && path.rays >= ray_budget) return false;
+            double w = std::max(weight.r(), std::max(weight.g(), weight.b()));
+            if (w <= 0) return false;
+            if (w < min_contribution) {
+                if (!russian_roulette) return false;
+                double survival = w / min_contribution;
+                if (path.random() >= survival) return false;
+                scale = 1 / survival;
+            }
+            path.rays++;
+            path.throughput = (scale == 1)? weight : weight * scale;
+            return true;
+        }
+        inline const Vector3 refraction_vector(const Vector3 &I, Vector3 &N, real n_it) const {
+            const real &cos_i = N.dot(I);
+            const real &sqrsin_i = 1 - cos_i*cos_i;
+            const real &k = 1 - (n_it*n_it) * sqrsin_i;
 
             if (k < 0) {
                 return reflection_vector(I, N);
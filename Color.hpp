@@ -5,34 +5,42 @@
 #define G e[1]
 #define B e[2]
 
-class Color: public Vector3 {
+template <typename T>
+class BasicColor: public BasicVector3<T> {
     public:
-        Color() { R = 0; G = 0; B = 0; }
-        explicit Color(Vector3 &v) { R = v.R; G = v.G; B = v.B; } 
-        Color(double r, double g, double b) { R = r; G = g; B = b; };
-        inline double r() const { return R; }
-        inline double g() const { return G; }
-        inline double b() const { return B; }
+        typedef typename Scalar<T>::type K;
+
+        BasicColor() {}
+        explicit BasicColor(const BasicVector3<T> &v): BasicVector3<T>(v) {}
+        BasicColor(K r, K g, K b): BasicVector3<T>(r, g, b) {};
+        inline T r() const { return this->R; }
+        inline T g() const { return this->G; }
+        inline T b() const { return this->B; }
 };
 
+typedef BasicColor<real> Color;
+
 const Color
     BLACK = Color(0, 0, 0),
     WHITE = Color(1, 1, 1);
 
-inline Color operator *(Color a, Color b) {
-    return Color ( a.R * b.R,
-                   a.G * b.G,
-                   a.B * b.B );
+template <typename T>
+inline BasicColor<T> operator *(const BasicColor<T> &a, const BasicColor<T> &b) {
+    return BasicColor<T> ( a.R * b.R,
+                           a.G * b.G,
+                           a.B * b.B );
 }
 
-inline Color operator +(Color a, Color b) {
-    return Color ( a.R + b.R,
-                    a.G + b.G,
-                    a.B + b.B );
+template <typename T>
+inline BasicColor<T> operator +(const BasicColor<T> &a, const BasicColor<T> &b) {
+    return BasicColor<T> ( a.R + b.R,
+                           a.G + b.G,
+                           a.B + b.B );
 }
 
-Color operator *(Color c, double k) {
-    return Color(c.R*k, c.G*k, c.B*k);
+template <typename T>
+inline BasicColor<T> operator *(const BasicColor<T> &c, const typename Scalar<T>::type k) {
+    return BasicColor<T>(c.R*k, c.G*k, c.B*k);
 }
 
 #undef R
@@ -0,0 +1,22 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+#include "Color.hpp"
+#include <vector>
+
+// Imagem em radiância linear (sem conversão nem limite), linha do topo primeiro.
+// A conversão para 8 bits ou float acontece só na saída, no ImageWriter.
+class Framebuffer {
+    public:
+        int width;
+        int height;
+        std::vector<Color> pixels;
+
+        Framebuffer(): width {0}, height {0} {}
+        Framebuffer(int width, int height): width {width}, height {height}, pixels(width * height) {}
+
+        inline Color& at(int row, int col) { return pixels[row * width + col]; }
+        inline const Color& at(int row, int col) const { return pixels[row * width + col]; }
+        inline const Color* row(int r) const { return &pixels[r * width]; }
+};
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef IMAGE_WRITER_HPP
+#define IMAGE_WRITER_HPP
+#include "Framebuffer.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// Destino sequencial dos bytes de uma imagem
+class ImageSink {
+    public:
+        virtual ~ImageSink() {}
+        virtual bool write(const char *data, size_t n) = 0;
+        virtual bool close() { return true; }
+};
+
+class StreamSink: public ImageSink {
+    public:
+        StreamSink(std::ostream &os): os {os} {}
+        bool write(const char *data, size_t n) { return (bool) os.write(data, n); }
+        bool close() { return (bool) os.flush(); }
+    private:
+        std::ostream &os;
+};
+
+// Escreve num buffer fornecido pelo usuário (veja ImageWriter::encoded_size)
+class MemorySink: public ImageSink {
+    public:
+        MemorySink(unsigned char *buffer, size_t capacity): buffer {buffer}, capacity {capacity} {}
+        bool write(const char *data, size_t n) {
+            if (used + n > capacity) return false;
+            memcpy(buffer + used, data, n);
+            used += n;
+            return true;
+        }
+        size_t size() const { return used; }
+    private:
+        unsigned char *buffer;
+        size_t capacity;
+        size_t used = 0;
+};
+
+// Arquivo de tamanho conhecido: é criado já com o tamanho final e mapeado em memória,
+// então cada escrita é só uma cópia. Sem mmap (Windows) usa fwrite com buffer grande.
+class FileSink: public ImageSink {
+    public:
+        FileSink(const std::string &path, size_t size): size {size} {
+#ifndef _WIN32
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0 && size > 0 && ftruncate(fd, size) == 0) {
+                void *address = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+                if (address != MAP_FAILED) mapping = (char*) address;
+            }
+            if (mapping || fd < 0) return;
+            ::close(fd);
+            fd = -1;
+#endif
+            file = fopen(path.c_str(), "wb");
+            if (file) setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        }
+        ~FileSink() { close(); }
+
+        bool is_open() const { return mapping || file; }
+
+        bool write(const char *data, size_t n) {
+            if (mapping) {
+                if (used + n > size) return false;
+                memcpy(mapping + used, data, n);
+                used += n;
+                return true;
+            }
+            return file && fwrite(data, 1, n, file) == n;
+        }
+
+        bool close() {
+            bool ok = true;
+#ifndef _WIN32
+            if (mapping) ok = munmap(mapping, size) == 0;
+            if (fd >= 0) ok = (::close(fd) == 0) && ok;
+            mapping = nullptr;
+            fd = -1;
+#endif
+            if (file) ok = (fclose(file) == 0) && ok;
+            file = nullptr;
+            return ok;
+        }
+
+    private:
+        size_t size;
+        size_t used = 0;
+        char *mapping = nullptr;
+        int fd = -1;
+        FILE *file = nullptr;
+};
+
+enum class ImageFormat {
+    PPM, // 8 bits por canal, cores limitadas a [0, 1]
+    PFM  // float por canal, radiância linear sem limite (HDR)
+};
+
+// Converte e grava linhas prontas do Framebuffer numa thread separada, para que a
+// saída se sobreponha à renderização. Quem renderiza avisa com rows_ready() as linhas
+// que terminou (em qualquer ordem); o escritor as grava na ordem do arquivo.
+class ImageWriter {
+    public:
+        ImageWriter(const Framebuffer &image, ImageFormat format, ImageSink &sink):
+            image {image}, format {format}, sink {sink}, ready(image.height, false)
+        {
+            worker = std::thread(&ImageWriter::run, this);
+        }
+        ~ImageWriter() { finish(); }
+
+        ImageWriter(const ImageWriter&) = delete;
+        ImageWriter& operator=(const ImageWriter&) = delete;
+
+        static size_t header_size(int width, int height, ImageFormat format) {
+            return header(width, height, format).size();
+        }
+        static size_t encoded_size(int width, int height, ImageFormat format) {
+            size_t pixel_bytes = (format == ImageFormat::PPM)? 3 : 3 * sizeof(float);
+            return header_size(width, height, format) + pixel_bytes * width * height;
+        }
+
+        // As linhas [first, first + count) do Framebuffer estão completas
+        void rows_ready(int first, int count) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int r = first; r < first + count; r++) ready[r] = true;
+            }
+            wake.notify_one();
+        }
+
+        // Marca todas as linhas como prontas
+        void all_rows_ready() { rows_ready(0, image.height); }
+
+        // Espera a gravação de todas as linhas e fecha o destino. Retorna false se alguma escrita falhou.
+        bool finish() {
+            if (worker.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finishing = true;
+                }
+                wake.notify_one();
+                worker.join();
+                ok = sink.close() && ok;
+            }
+            return ok;
+        }
+
+    private:
+        const Framebuffer &image;
+        ImageFormat format;
+        ImageSink &sink;
+        std::vector<bool> ready;
+        bool finishing = false;
+        bool ok = true;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread worker;
+
+        static std::string header(int width, int height, ImageFormat format) {
+            if (format == ImageFormat::PPM) return "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+            // O sinal da escala indica a ordem dos bytes dos floats: negativo para little-endian
+            const uint16_t probe = 1;
+            bool little_endian = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+            return "PF\n" + std::to_string(width) + " " + std::to_string(height) + (little_endian? "\n-1.0\n" : "\n1.0\n");
+        }
+
+        // Linha da imagem que vai na posição 'k' do arquivo: PPM grava do topo para baixo, PFM de baixo para cima
+        int file_row(int k) const { return (format == ImageFormat::PPM)? k : image.height - 1 - k; }
+
+        void run() {
+            std::string h = header(image.width, image.height, format);
+            ok = sink.write(h.data(), h.size());
+
+            std::vector<char> buffer;
+            int next = 0;
+            while (next < image.height) {
+                // Junta o maior trecho de linhas consecutivas já prontas
+                int end = next;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return ready[file_row(next)] || finishing; });
+                    while (end < image.height && ready[file_row(end)]) end++;
+                    if (end == next) {
+                        // finish() sem todas as linhas: grava o que houver no Framebuffer
+                        end = image.height;
+                    }
+                }
+                for (int k = next; k < end; k++) {
+                    encode_row(file_row(k), buffer);
+                    ok = sink.write(buffer.data(), buffer.size()) && ok;
+                }
+                next = end;
+            }
+        }
+
+        void encode_row(int r, std::vector<char> &buffer) const {
+            const Color *row = image.row(r);
+            if (format == ImageFormat::PPM) {
+                buffer.resize(3 * image.width);
+                for (int j = 0; j < image.width; j++) {
+                    buffer[3 * j]     = static_cast<unsigned char>(std::min(255.0, row[j].r() * 255.99));
+                    buffer[3 * j + 1] = static_cast<unsigned char>(std::min(255.0, row[j].g() * 255.99));
+                    buffer[3 * j + 2] = static_cast<unsigned char>(std::min(255.0, row[j].b() * 255.99));
+                }
+            } else {
+                buffer.resize(3 * sizeof(float) * image.width);
+                float *out = reinterpret_cast<float*>(buffer.data());
+                for (int j = 0; j < image.width; j++) {
+                    out[3 * j]     = (float) row[j].r();
+                    out[3 * j + 1] = (float) row[j].g();
+                    out[3 * j + 2] = (float) row[j].b();
+                }
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef INSTANCE_HPP
+#define INSTANCE_HPP
+#include "Object.hpp"
+#include "Transform.hpp"
+
+// Cópia posicionada de um objeto compartilhado (tipicamente uma TriangleMesh): a
+// geometria e a BVH existem uma vez só, e cada Instance guarda apenas a transformação.
+// Os raios são levados para o espaço do objeto, testados lá e o acerto volta para o mundo.
+//
+// As transformações se acumulam na ordem das chamadas, em coordenadas do mundo:
+// instance.scale(...), depois rotate(...), depois translate(...). Depois de mudar a
+// transformação de um objeto já adicionado, chame Scene::build() de novo.
+// Se 'material' for definido, ele substitui o material do objeto nesta cópia.
+class Instance: public Object {
+    public:
+        Instance(Object *object): object {object} {}
+        Instance(Object *object, const Transform &to_world): object {object} { set_transform(to_world); }
+
+        Object *object;
+
+        void set_transform(const Transform &transform) {
+            to_world = transform;
+            to_object = transform.inverse();
+        }
+        const Transform& transform() const { return to_world; }
+
+        void translate(Vector3 v) { apply(Transform::translation(v)); }
+        void translate(real x, real y, real z) { translate(Vector3(x, y, z)); }
+        // Ângulos em radianos, aplicados em torno de x, depois y, depois z
+        void rotate(Vector3 v) { rotate(v.x(), v.y(), v.z()); }
+        void rotate(real x, real y, real z) {
+            apply(Transform::rotation(2, z) * Transform::rotation(1, y) * Transform::rotation(0, x));
+        }
+        void scale(real k) { scale(Vector3(k, k, k)); }
+        void scale(Vector3 factor) { apply(Transform::scaling(factor)); }
+
+        std::string to_string() {
+            return "Instância de " + object->to_string();
+        }
+
+        bool get_bounds(BoundingBox &box) const {
+            BoundingBox local;
+            if (!object->get_bounds(local)) return false;
+            box = to_world.bounds(local);
+            return true;
+        }
+
+        // A direção no espaço do objeto é normalizada, como os objetos esperam; a distância
+        // encontrada lá é convertida de volta dividindo pelo fator de escala do raio.
+        Intersection raycast(const Vector3 &p, const Vector3 &v) const {
+            Vector3 origin = to_object.point(p), direction = to_object.vector(v);
+            real scale = direction.length();
+            Intersection hit = object->raycast(origin, direction / scale);
+            if (hit.distance == INFINITY) return hit;
+            return Intersection(hit.distance / scale, this, to_object.normal_from_inverse(hit.normal).normalized(),
+                                (material == default_material)? hit.material : material, hit.u, hit.v);
+        }
+
+        bool occluded(const Vector3 &p, const Vector3 &v, real t_max) const override {
+            Vector3 direction = to_object.vector(v);
+            real scale = direction.length();
+            return object->occluded(to_object.point(p), direction / scale, t_max * scale);
+        }
+
+    private:
+        Transform to_world;
+        Transform to_object;
+
+        void apply(const Transform &transform) { set_transform(transform * to_world); }
+};
+
+#endif
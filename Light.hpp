@@ -0,0 +1,77 @@
+#ifndef LIGHT_HPP
+#define LIGHT_HPP
+#include "Vector3.hpp"
+#include "Color.hpp"
+#include "BoundingBox.hpp"
+#include "BVH.hpp"
+#include <math.h>
+#include <vector>
+
+// Luz pontual. Com 'range' finito a intensidade cai suavemente até zero na distância
+// 'range' (janela (1 - (d/range)²)², sem o termo do inverso do quadrado), e a luz pode
+// ser ignorada em pontos mais distantes; com range infinito ela vale o mesmo em toda a cena.
+struct Light {
+    Vector3 position;
+    Color color = WHITE;
+    real range = INFINITY;
+    Light(Vector3 p): position {p} {}
+    Light(real x, real y, real z): position {Vector3(x, y, z)} {}
+    Light() {}
+
+    inline bool bounded() const { return range < INFINITY; }
+
+    // Fator de atenuação à distância 'distance' (1 sem alcance)
+    inline real falloff(real distance) const {
+        if (!bounded()) return 1;
+        real x = distance / range;
+        if (x >= 1) return 0;
+        real w = 1 - x * x;
+        return w * w;
+    }
+
+    BoundingBox bounds() const {
+        Vector3 r(range, range, range);
+        return BoundingBox(position - r, position + r);
+    }
+};
+
+// Estrutura de aceleração das luzes: uma BVH sobre as caixas de alcance das luzes
+// limitadas, para achar só as que podem iluminar um ponto, e a lista das ilimitadas.
+// Deve ser reconstruída sempre que posições ou alcances mudarem.
+class LightTree {
+    public:
+        void build(const std::vector<Light> &lights) {
+            unbounded.clear();
+            bounded.clear();
+            std::vector<BoundingBox> light_bounds;
+            for (size_t i = 0; i < lights.size(); i++) {
+                if (lights[i].bounded()) {
+                    bounded.push_back((int) i);
+                    light_bounds.push_back(lights[i].bounds());
+                } else {
+                    unbounded.push_back((int) i);
+                }
+            }
+            bvh.build_threads = 1;
+            bvh.build(light_bounds);
+            count = lights.size();
+        }
+
+        size_t size() const { return count; }
+
+        // Chama 'visit(i)' para cada luz cuja caixa de alcance contém 'p' (índices no vetor
+        // dado a build); as ilimitadas vêm primeiro, na ordem original
+        template <typename Visitor>
+        void visit(const Vector3 &p, Visitor &&visit) const {
+            for (int i : unbounded) visit(i);
+            bvh.containing(p, [&](int k) { visit(bounded[k]); });
+        }
+
+    private:
+        std::vector<int> unbounded;
+        std::vector<int> bounded;
+        BVH bvh;
+        size_t count = 0;
+};
+
+#endif
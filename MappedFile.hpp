@@ -0,0 +1,99 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+#include <string>
+#include <stddef.h>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Arquivo mapeado em memória somente para leitura. O conteúdo fica disponível em
+// data()/size() sem cópia; o sistema carrega as páginas sob demanda.
+class MappedFile {
+    public:
+        MappedFile() {}
+        explicit MappedFile(const std::string &path) { open(path); }
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string &path) {
+            close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER file_size;
+            GetFileSizeEx(file, &file_size);
+            length = (size_t) file_size.QuadPart;
+            opened = true;
+            if (length == 0) return true;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) bytes = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0) {
+                close();
+                return false;
+            }
+            length = (size_t) info.st_size;
+            opened = true;
+            if (length == 0) return true;
+            void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                bytes = (const char*) address;
+                madvise(address, length, MADV_SEQUENTIAL);
+            }
+#endif
+            if (!bytes) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (bytes) UnmapViewOfFile(bytes);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (bytes) munmap((void*) bytes, length);
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#endif
+            bytes = nullptr;
+            length = 0;
+            opened = false;
+        }
+
+        bool is_open() const { return opened; }
+        const char* data() const { return bytes; }
+        size_t size() const { return length; }
+        const char* begin() const { return bytes; }
+        const char* end() const { return bytes + length; }
+
+    private:
+        const char *bytes = nullptr;
+        size_t length = 0;
+        bool opened = false;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+};
+
+#endif
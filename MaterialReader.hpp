@@ -2,107 +2,87 @@
 #define MATERIAL_READER_HPP
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
-#include <map>
+#include <unordered_map>
+#include <vector>
 #include "Object.hpp"
 #include "Color.hpp"
+#include "MappedFile.hpp"
+#include "TextParser.hpp"
 
 class MaterialReader {
 public:
-    // Mapa que relaciona o nome do material com as suas propriedades
-    std::map<std::string, Object::Material> materials;
+    // Materiais contíguos, na ordem do arquivo, e o índice de cada um pelo nome.
+    // Os ponteiros de getMaterial valem enquanto 'materials' não crescer.
+    std::vector<Object::Material> materials;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> index;
 
     MaterialReader() {}
 
-    // Construtor que lê o arquivo .mtl passado em 'filepath'
+    // Construtor que lê o arquivo .mtl passado em 'filepath' (mapeado em memória, em uma passada)
     MaterialReader(const std::string &filepath) {
-        std::ifstream file(filepath);
+        MappedFile file(filepath);
         if (!file.is_open()) {
             std::cerr << "Erro ao abrir o arquivo .mtl: " << filepath << std::endl;
             return;
         }
 
-        std::string line;
-        std::string currentMaterial;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string keyword;
-            iss >> keyword;
-
-            if (keyword == "newmtl") {
-                iss >> currentMaterial;
-                if (!currentMaterial.empty()) {
-                    materials[currentMaterial] = Object::Material();
-                }
-            }
-            else if (keyword == "Kd") {
-                double r, g, b;
-                iss >> r >> g >> b;
-                if (!currentMaterial.empty()) {
-                    // Kd = Difuso
-                    materials[currentMaterial].diffuse = Color(r, g, b);
-                }
-            }
-            else if (keyword == "Ks") {
-                double r, g, b;
-                iss >> r >> g >> b;
-                if (!currentMaterial.empty()) {
-                    // Ks = Specular
-                    materials[currentMaterial].specular = Color(r, g, b);
-                }
-            }
-            else if (keyword == "Ke") {
-                double r, g, b;
-                iss >> r >> g >> b;
-                if (!currentMaterial.empty()) {
-                    // Ke = Emissive
-                    materials[currentMaterial].emissive = Color(r, g, b);
-                }
-            }
-            else if (keyword == "Ka") {
-                double r, g, b;
-                iss >> r >> g >> b;
-                if (!currentMaterial.empty()) {
-                    // Ka = Ambiente
-                    materials[currentMaterial].ambient = Color(r, g, b);
-                }
-            }
-            else if (keyword == "Ns") {
-                double ns;
-                iss >> ns;
-                if (!currentMaterial.empty()) {
-                    materials[currentMaterial].ns = ns;
-                }
-            }
-            else if (keyword == "Ni") {
-                double ni;
-                iss >> ni;
-                if (!currentMaterial.empty()) {
-                    materials[currentMaterial].ni = ni;
-                }
+        TextParser in(file.begin(), file.end());
+        Object::Material *current = nullptr;
+        while (!in.at_end()) {
+            if (in.keyword("newmtl")) {
+                std::string name = in.word();
+                current = name.empty()? nullptr : &(materials[define(name)] = Object::Material());
             }
-            else if (keyword == "d") {
-                double d;
-                iss >> d;
-                if (!currentMaterial.empty()) {
-                    materials[currentMaterial].opacity = d;
-                }
+            else if (current) {
+                if      (in.keyword("Kd")) read_color(in, current->diffuse);   // Kd = Difuso
+                else if (in.keyword("Ks")) read_color(in, current->specular);  // Ks = Specular
+                else if (in.keyword("Ke")) read_color(in, current->emissive);  // Ke = Emissive
+                else if (in.keyword("Ka")) read_color(in, current->ambient);   // Ka = Ambiente
+                else if (in.keyword("Ns")) read_number(in, current->ns);
+                else if (in.keyword("Ni")) read_number(in, current->ni);
+                else if (in.keyword("d"))  read_number(in, current->opacity);
             }
+            in.next_line();
         }
-        file.close();
+    }
+
+    // Índice do material em 'materials', ou -1 se não definido
+    int find(const std::string &materialName) const {
+        auto it = index.find(materialName);
+        return (it != index.end())? it->second : -1;
     }
 
     // Retorna um ponteiro para o material correspondente ou nullptr se não encontrado
     Object::Material* getMaterial(const std::string &materialName) {
-        auto it = materials.find(materialName);
-        if (it != materials.end()) {
-            return &(it->second);
+        int i = find(materialName);
+        if (i >= 0) {
+            return &materials[i];
         }
         std::cerr << "Erro: material '" << materialName << "' não definido no arquivo .mtl." << std::endl;
         return nullptr;
     }
+
+private:
+    // Índice do material 'name', criando-o se for novo; um "newmtl" repetido redefine o material
+    int define(const std::string &name) {
+        auto it = index.find(name);
+        if (it != index.end()) return it->second;
+        index.emplace(name, (int) materials.size());
+        names.push_back(name);
+        materials.emplace_back();
+        return (int) materials.size() - 1;
+    }
+
+    static void read_color(TextParser &in, Color &color) {
+        double r, g, b;
+        if (in.parse_double(r) && in.parse_double(g) && in.parse_double(b)) color = Color(r, g, b);
+    }
+    static void read_number(TextParser &in, real &value) {
+        double d;
+        if (in.parse_double(d)) value = d;
+    }
 };
 
 #endif
@@ -0,0 +1,238 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+#include "TriangleMesh.hpp"
+#include "MappedFile.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cache binário de uma TriangleMesh já processada: vértices, materiais das faces,
+// tabela de materiais, BVH e blocos SIMD das folhas. O arquivo é mapeado em memória
+// e os arrays da malha apontam direto para ele, sem cópia nem parsing.
+//
+// Formato (versão 3): um Header seguido das seções, cada uma alinhada a 64 bytes.
+// O cache guarda tamanho e data de modificação do .obj e do .mtl de origem e o
+// tamanho de cada tipo gravado; se algo não bater ele é considerado desatualizado.
+class MeshCache {
+    public:
+        static const uint32_t version = 3;
+
+        enum SectionId { VERTICES, FACE_MATERIALS, MATERIALS, BVH_NODES, BVH_INDICES, BLOCKS, NODE_BLOCKS, SECTION_COUNT };
+
+        struct Section {
+            uint64_t offset;
+            uint64_t count;
+        };
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t endian;          // 0x01020304 na ordem de bytes de quem gravou
+            uint32_t type_sizes[SECTION_COUNT];
+            int32_t max_leaf_size;
+            int64_t obj_size, obj_mtime;
+            int64_t mtl_size, mtl_mtime;
+            Section sections[SECTION_COUNT];
+        };
+
+        // Caminho padrão do cache: o do .obj com extensão .rtcache
+        static std::string default_path(const std::string &obj_path) {
+            return obj_path.substr(0, obj_path.find_last_of('.')) + ".rtcache";
+        }
+
+        // Abre a malha pelo cache; se ele estiver ausente ou desatualizado, lê o .obj
+        // e regrava o cache para a próxima vez. Retorna false se nenhum dos dois funcionar.
+        static bool open(TriangleMesh &mesh, const std::string &obj_path, std::string cache_path = "", int load_threads = 0) {
+            if (cache_path.empty()) cache_path = default_path(obj_path);
+            if (load(mesh, cache_path, obj_path)) return true;
+            if (!mesh.load_obj(obj_path, load_threads)) return false;
+            if (!save(mesh, cache_path, obj_path)) {
+                std::cerr << "Aviso: não foi possível gravar o cache " << cache_path << std::endl;
+            }
+            return true;
+        }
+
+        static bool save(const TriangleMesh &mesh, const std::string &cache_path, const std::string &obj_path) {
+            Header header = make_header(obj_path);
+            header.max_leaf_size = mesh.bvh.max_leaf_size;
+
+            const void *data[SECTION_COUNT] = {
+                mesh.vertices.data(), mesh.face_materials.data(), mesh.materials.data(),
+                mesh.bvh.nodes.data(), mesh.bvh.indices.data(), mesh.blocks.data(), mesh.node_blocks.data()
+            };
+            size_t counts[SECTION_COUNT] = {
+                mesh.vertices.size(), mesh.face_materials.size(), mesh.materials.size(),
+                mesh.bvh.nodes.size(), mesh.bvh.indices.size(), mesh.blocks.size(), mesh.node_blocks.size()
+            };
+
+            uint64_t offset = align(sizeof(Header));
+            for (int s = 0; s < SECTION_COUNT; s++) {
+                header.sections[s].offset = offset;
+                header.sections[s].count = counts[s];
+                offset = align(offset + counts[s] * header.type_sizes[s]);
+            }
+
+            // Grava num arquivo temporário e renomeia, para que um leitor nunca veja um cache pela metade
+            std::string temp_path = cache_path + ".tmp";
+            FILE *f = fopen(temp_path.c_str(), "wb");
+            if (!f) return false;
+            bool ok = fwrite(&header, sizeof(Header), 1, f) == 1;
+            for (int s = 0; s < SECTION_COUNT && ok; s++) {
+                ok = pad_to(f, header.sections[s].offset);
+                size_t bytes = counts[s] * header.type_sizes[s];
+                if (ok && bytes > 0) ok = fwrite(data[s], 1, bytes, f) == bytes;
+            }
+            ok = ok && pad_to(f, offset);
+            ok = (fclose(f) == 0) && ok;
+            if (ok) {
+                remove(cache_path.c_str());
+                ok = rename(temp_path.c_str(), cache_path.c_str()) == 0;
+            }
+            if (!ok) remove(temp_path.c_str());
+            return ok;
+        }
+
+        // Preenche 'mesh' a partir do cache. Retorna false (sem mexer na malha) se o cache
+        // não existir, for de outra versão ou layout, estiver mais antigo que o .obj/.mtl
+        // ou tiver algum índice fora dos limites.
+        static bool load(TriangleMesh &mesh, const std::string &cache_path, const std::string &obj_path) {
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cache_path);
+            if (!file->is_open() || file->size() < sizeof(Header)) return false;
+
+            Header header;
+            memcpy(&header, file->data(), sizeof(Header));
+            Header expected = make_header(obj_path);
+            if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+                header.version != expected.version || header.endian != expected.endian ||
+                memcmp(header.type_sizes, expected.type_sizes, sizeof(header.type_sizes)) != 0) return false;
+            if (header.obj_size != expected.obj_size || header.obj_mtime != expected.obj_mtime ||
+                header.mtl_size != expected.mtl_size || header.mtl_mtime != expected.mtl_mtime) return false;
+
+            for (int s = 0; s < SECTION_COUNT; s++) {
+                const Section &section = header.sections[s];
+                if (section.offset % 64 != 0 || section.offset > file->size() ||
+                    section.count > (file->size() - section.offset) / header.type_sizes[s]) return false;
+            }
+
+            // Os arrays são emprestados numa malha temporária e só passam para 'mesh' depois
+            // de conferidos, para que um cache corrompido nunca seja percorrido
+            TriangleMesh cached;
+            std::shared_ptr<const void> owner = file;
+            borrow(cached.vertices, *file, header, VERTICES, owner);
+            borrow(cached.face_materials, *file, header, FACE_MATERIALS, owner);
+            borrow(cached.materials, *file, header, MATERIALS, owner);
+            borrow(cached.bvh.nodes, *file, header, BVH_NODES, owner);
+            borrow(cached.bvh.indices, *file, header, BVH_INDICES, owner);
+            borrow(cached.blocks, *file, header, BLOCKS, owner);
+            borrow(cached.node_blocks, *file, header, NODE_BLOCKS, owner);
+            if (!in_range(cached)) return false;
+
+            mesh.vertices.swap(cached.vertices);
+            mesh.indices.clear();
+            mesh.face_materials.swap(cached.face_materials);
+            mesh.materials.swap(cached.materials);
+            mesh.bvh.nodes.swap(cached.bvh.nodes);
+            mesh.bvh.indices.swap(cached.bvh.indices);
+            mesh.blocks.swap(cached.blocks);
+            mesh.node_blocks.swap(cached.node_blocks);
+            mesh.bvh.max_leaf_size = header.max_leaf_size;
+            return true;
+        }
+
+    private:
+        // Confere, numa passada linear, todos os índices que a travessia e o sombreamento seguem:
+        // filhos e primitivas dos nós (e a profundidade, limitada pela pilha da travessia),
+        // blocos de cada folha, vértices dos blocos, números dos triângulos e materiais.
+        static bool in_range(const TriangleMesh &mesh) {
+            const BVH &bvh = mesh.bvh;
+            size_t node_count = bvh.nodes.size(), faces = mesh.face_materials.size();
+            if (mesh.node_blocks.size() != node_count || bvh.indices.size() != faces) return false;
+            if ((node_count == 0) != (faces == 0)) return false;
+
+            std::vector<int> depth(node_count, 0);
+            if (node_count > 0) depth[0] = 1;
+            for (size_t n = 0; n < node_count; n++) {
+                const BVH::Node &node = bvh.nodes[n];
+                if (depth[n] == 0 || depth[n] > BVH::max_depth || node.count < 0 || node.first < 0) return false;
+                if (node.is_leaf()) {
+                    int block = mesh.node_blocks[n], block_count = (node.count + 3) / 4;
+                    if ((size_t) node.first > faces || (size_t) node.count > faces - node.first) return false;
+                    if (block < 0 || (size_t) block > mesh.blocks.size() ||
+                        (size_t) block_count > mesh.blocks.size() - block) return false;
+                    for (int b = 0; b < block_count; b++) {
+                        if (mesh.blocks[block + b].count != std::min(4, node.count - 4 * b)) return false;
+                    }
+                } else {
+                    // Os filhos vêm sempre depois do pai, o que também descarta ciclos
+                    if (mesh.node_blocks[n] != -1) return false;
+                    if ((size_t) node.first <= n || (size_t) node.first + 1 >= node_count) return false;
+                    if (depth[node.first] != 0 || depth[node.first + 1] != 0) return false;
+                    depth[node.first] = depth[node.first + 1] = depth[n] + 1;
+                }
+            }
+            for (int face : bvh.indices) {
+                if (face < 0 || (size_t) face >= faces) return false;
+            }
+            for (const Triangle4 &block : mesh.blocks) {
+                for (int k = 0; k < 3; k++)
+                    for (int lane = 0; lane < 4; lane++)
+                        if (block.v[k][lane] < 0 || (size_t) block.v[k][lane] >= mesh.vertices.size()) return false;
+            }
+            for (int material : mesh.face_materials) {
+                if (material < -1 || material >= (int) mesh.materials.size()) return false;
+            }
+            return true;
+        }
+
+        static uint64_t align(uint64_t offset) { return (offset + 63) & ~(uint64_t) 63; }
+
+        static bool pad_to(FILE *f, uint64_t offset) {
+            static const char zeros[64] = {0};
+            long position = ftell(f);
+            if (position < 0 || (uint64_t) position > offset) return false;
+            size_t n = (size_t) (offset - position);
+            return n == 0 || fwrite(zeros, 1, n, f) == n;
+        }
+
+        // Tamanho e data de modificação; -1 se o arquivo não existir
+        static void file_signature(const std::string &path, int64_t &size, int64_t &mtime) {
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0) {
+                size = mtime = -1;
+                return;
+            }
+            size = (int64_t) info.st_size;
+            mtime = (int64_t) info.st_mtime;
+        }
+
+        static Header make_header(const std::string &obj_path) {
+            Header header;
+            memset(&header, 0, sizeof(Header));
+            memcpy(header.magic, "RTMESH\0\0", 8);
+            header.version = version;
+            header.endian = 0x01020304;
+            header.type_sizes[VERTICES] = sizeof(Vector3);
+            header.type_sizes[FACE_MATERIALS] = sizeof(int);
+            header.type_sizes[MATERIALS] = sizeof(Object::Material);
+            header.type_sizes[BVH_NODES] = sizeof(BVH::Node);
+            header.type_sizes[BVH_INDICES] = sizeof(int);
+            header.type_sizes[BLOCKS] = sizeof(Triangle4);
+            header.type_sizes[NODE_BLOCKS] = sizeof(int);
+            file_signature(obj_path, header.obj_size, header.obj_mtime);
+            file_signature(TriangleMesh::mtl_path(obj_path), header.mtl_size, header.mtl_mtime);
+            return header;
+        }
+
+        template <typename T>
+        static void borrow(Array<T> &array, const MappedFile &file, const Header &header, SectionId id, const std::shared_ptr<const void> &owner) {
+            const Section &section = header.sections[id];
+            array.borrow(reinterpret_cast<const T*>(file.data() + section.offset), (size_t) section.count, owner);
+        }
+};
+
+#endif
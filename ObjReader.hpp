@@ -0,0 +1,182 @@
+#ifndef OBJ_READER_HPP
+#define OBJ_READER_HPP
+#include "Vector3.hpp"
+#include "MappedFile.hpp"
+#include "TextParser.hpp"
+#include "ThreadPool.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Leitor de .obj em uma única passada sobre o arquivo mapeado em memória.
+// Lê vértices ("v"), faces ("f", já trianguladas em fan) e trocas de material ("usemtl").
+// Índices negativos são relativos ao último vértice lido; nas formas v/vt, v//vn e
+// v/vt/vn só o índice do vértice é usado. Arquivos grandes podem ser divididos em
+// blocos de linhas lidos em paralelo.
+class ObjReader {
+    public:
+        struct Face {
+            int v[3];      // índices (a partir de 0) em 'vertices'
+            int material;  // índice em 'material_names', ou -1 sem usemtl
+        };
+
+        std::vector<Vector3> vertices;
+        std::vector<Face> faces;
+        std::vector<std::string> material_names;
+        bool ok = false;
+
+        // Arquivos menores que isso são lidos por uma thread só
+        static const size_t parallel_threshold = 8 << 20;
+
+        ObjReader() {}
+
+        // 'threads' = 0 usa todos os núcleos
+        ObjReader(const std::string &filepath, int threads = 0) {
+            MappedFile file(filepath);
+            if (!file.is_open()) {
+                std::cerr << "Erro ao abrir o arquivo: " << filepath << std::endl;
+                return;
+            }
+            int chunk_count = (threads > 0)? threads : ThreadPool::default_thread_count();
+            if (file.size() < parallel_threshold) chunk_count = 1;
+
+            // Divide o arquivo em blocos que terminam em fim de linha
+            std::vector<const char*> bounds;
+            bounds.push_back(file.begin());
+            for (int k = 1; k < chunk_count; k++) {
+                const char *split = file.begin() + file.size() * k / chunk_count;
+                if (split < bounds.back()) split = bounds.back();
+                TextParser line(split, file.end());
+                line.next_line();
+                bounds.push_back(line.cur);
+            }
+            bounds.push_back(file.end());
+
+            std::vector<Chunk> chunks(chunk_count);
+            if (chunk_count == 1) {
+                chunks[0].parse(bounds[0], bounds[1]);
+            } else {
+                ThreadPool pool(chunk_count);
+                for (int k = 0; k < chunk_count; k++) {
+                    pool.submit([&chunks, &bounds, k] { chunks[k].parse(bounds[k], bounds[k + 1]); });
+                }
+                pool.wait();
+            }
+            merge(chunks);
+            ok = true;
+        }
+
+    private:
+        // Índice de vértice ainda não resolvido: absoluto (base 0) ou relativo ao início do bloco
+        struct RawIndex {
+            long value;
+            bool relative;
+        };
+        struct RawFace {
+            RawIndex v[3];
+            int material; // índice nos nomes do bloco, ou -1 para herdar o material corrente do bloco anterior
+        };
+
+        struct Chunk {
+            std::vector<Vector3> vertices;
+            std::vector<RawFace> faces;
+            std::vector<std::string> material_names;
+            long invalid_tokens = 0;
+
+            void parse(const char *begin, const char *end) {
+                TextParser in(begin, end);
+                int current_material = -1;
+                std::vector<RawIndex> polygon;
+
+                while (!in.at_end()) {
+                    if (in.keyword("v")) {
+                        double x, y, z;
+                        if (in.parse_double(x) && in.parse_double(y) && in.parse_double(z)) {
+                            vertices.push_back(Vector3(x, y, z));
+                        }
+                    }
+                    else if (in.keyword("f")) {
+                        polygon.clear();
+                        while (!in.end_of_line()) {
+                            long index;
+                            if (!in.parse_int(index) || index == 0) {
+                                invalid_tokens++;
+                                in.skip_word();
+                                continue;
+                            }
+                            in.skip_word();
+                            // Positivo: 1-indexado no arquivo. Negativo: relativo ao último vértice lido.
+                            if (index > 0) polygon.push_back({index - 1, false});
+                            else polygon.push_back({(long) vertices.size() + index, true});
+                        }
+                        // Triangulação em fan para faces com mais de 3 vértices
+                        for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                            faces.push_back({{polygon[0], polygon[i], polygon[i + 1]}, current_material});
+                        }
+                    }
+                    else if (in.keyword("usemtl")) {
+                        std::string name = in.word();
+                        current_material = (int) material_names.size();
+                        material_names.push_back(name);
+                    }
+                    in.next_line();
+                }
+            }
+        };
+
+        void merge(std::vector<Chunk> &chunks) {
+            size_t vertex_count = 0, face_count = 0;
+            for (const Chunk &c : chunks) {
+                vertex_count += c.vertices.size();
+                face_count += c.faces.size();
+            }
+            vertices.reserve(vertex_count);
+            faces.reserve(face_count);
+
+            std::map<std::string, int> material_index;
+            int current_material = -1;
+            long invalid_tokens = 0, invalid_faces = 0;
+
+            for (Chunk &c : chunks) {
+                long offset = (long) vertices.size();
+                vertices.insert(vertices.end(), c.vertices.begin(), c.vertices.end());
+                invalid_tokens += c.invalid_tokens;
+
+                // Traduz os nomes de material do bloco para a tabela global
+                std::vector<int> global_material(c.material_names.size());
+                for (size_t m = 0; m < c.material_names.size(); m++) {
+                    auto it = material_index.find(c.material_names[m]);
+                    if (it == material_index.end()) {
+                        it = material_index.emplace(c.material_names[m], (int) material_names.size()).first;
+                        material_names.push_back(c.material_names[m]);
+                    }
+                    global_material[m] = it->second;
+                }
+
+                for (const RawFace &raw : c.faces) {
+                    if (raw.material >= 0) current_material = global_material[raw.material];
+                    Face face;
+                    face.material = current_material;
+                    bool valid = true;
+                    for (int k = 0; k < 3; k++) {
+                        long index = raw.v[k].relative? offset + raw.v[k].value : raw.v[k].value;
+                        valid = valid && index >= 0 && index < (long) vertex_count;
+                        face.v[k] = (int) index;
+                    }
+                    if (valid) faces.push_back(face);
+                    else invalid_faces++;
+                }
+                // Um usemtl sem faces depois dele ainda vale para o próximo bloco
+                if (!c.material_names.empty()) current_material = global_material.back();
+
+                std::vector<Vector3>().swap(c.vertices);
+                std::vector<RawFace>().swap(c.faces);
+            }
+
+            if (invalid_tokens > 0) std::cerr << "Formato de face inválido em " << invalid_tokens << " vértices de face" << std::endl;
+            if (invalid_faces > 0) std::cerr << invalid_faces << " faces com índices de vértice fora do intervalo foram ignoradas" << std::endl;
+        }
+};
+
+#endif
@@ -2,11 +2,13 @@
 #define OBJECT_HPP
 #include "Vector3.hpp"
 #include "Color.hpp"
+#include "BoundingBox.hpp"
+#include "SIMD.hpp"
 #include <math.h>
 #include <vector>
 #include <string>
 
-const double epsilon = 1.0E-6;
+const real epsilon = Precision<real>::epsilon; // afastamento mínimo dos raios secundários e de sombra
 
 class Object {
 
@@ -19,31 +21,55 @@ public:
         specular = Color (0.0, 0.0, 0.0),
         ambient  = Color (0.1, 0.1, 0.1),
         emissive = Color (0.0, 0.0, 0.0);
-        double  opacity  = 1,
+        real  opacity  = 1,
                 ni       = 1,
                 ns       = 10;
     } *material;
     
+    // Registro completo do acerto, devolvido por uma única chamada const de raycast:
+    // o objeto não guarda estado do último raio, então vários raios podem ser traçados ao mesmo tempo.
     struct Intersection {
-        double distance;
-        Object *object;
-        Intersection(double d): distance {d},  object {nullptr} {};
-        Intersection(double d, Object *o): distance {d}, object {o} {};
+        real distance;
+        const Object *object;
+        Vector3 normal;
+        const Material *material;
+        real u, v; // coordenadas baricêntricas (pesos do 2º e 3º vértice) em triângulos
+        Intersection(): Intersection(INFINITY) {};
+        Intersection(real d): distance {d}, object {nullptr}, material {nullptr}, u {0}, v {0} {};
+        Intersection(real d, const Object *o, const Vector3 &normal, const Material *m, real u = 0, real v = 0):
+            distance {d}, object {o}, normal {normal}, material {m}, u {u}, v {v} {};
     };
-    virtual Intersection raycast(Vector3 p, Vector3 v) = 0;
-    virtual Vector3 get_normal(const Vector3 &p) = 0;
+    virtual Intersection raycast(const Vector3 &p, const Vector3 &v) const = 0;
+    // Testa as faixas de 'mask' de um pacote de raios. Objetos sem um teste vetorizado
+    // próprio usam o raycast escalar em cada faixa.
+    virtual void raycast_packet(const RayPacket4 &rays, int mask, Intersection hits[4]) const {
+        for (int lane = 0; lane < 4; lane++) {
+            hits[lane] = (mask & (1 << lane))? raycast(rays.get_origin(lane), rays.get_direction(lane)) : Intersection();
+        }
+    }
     virtual std::string to_string() = 0;
+    // Preenche 'box' com a caixa envolvente do objeto. Objetos ilimitados (como o plano) retornam false.
+    virtual bool get_bounds(BoundingBox &/* box */) const { return false; }
+    // Preenche 'center' e 'radius' se o objeto for uma esfera simples, que a cena pode
+    // testar junto com outras (Sphere4) chamando o raycast só para a mais próxima.
+    virtual bool get_sphere(Vector3 &/* center */, real &/* radius */) const { return false; }
+    // Verdadeiro se o raio (p, v), com v normalizado, atinge o objeto a uma distância entre
+    // epsilon e t_max. Usado pelos raios de sombra, que só precisam saber se há algo no
+    // caminho até a luz; objetos com um teste mais barato que o raycast o sobrescrevem.
+    virtual bool occluded(const Vector3 &p, const Vector3 &v, real t_max) const {
+        real distance = raycast(p, v).distance;
+        return distance > epsilon && distance < t_max;
+    }
     
     static Material *default_material;
 
-    //void rotate(Vector3 v) { rotate(v.x(), v.y(), v.z()); }
-    //virtual void rotate(double x, double y, double z) = 0;
-    //void translate(Vector3 v) { translate(v.x(), v.y(), v.z()); }
-    //virtual void translate(double x, double y, double z) = 0;
+    // rotate/translate: veja Instance, que posiciona um objeto compartilhado com uma Transform
 
 };
 
-Object::Material* Object::default_material = new Object::Material();
+// Material de quem não recebeu um; um objeto estático, não alocado no heap
+static Object::Material default_material_storage;
+Object::Material* Object::default_material = &default_material_storage;
 
 class Plane: public Object {
 
@@ -55,18 +81,24 @@ public:
         return "Plano de normal (" + std::to_string(normal.x()) +", "+ std::to_string(normal.y()) +", "+ std::to_string(normal.z())+")";
         }
 
-    Vector3 get_normal(const Vector3 &p) { return normal; }
-    Intersection raycast(Vector3 p, Vector3 v) {
+    Intersection raycast(const Vector3 &p, const Vector3 &v) const {
 
-        double sin = normal.dot(v);
+        real sin = normal.dot(v);
 
         if (fabs(sin) <= epsilon) {
             return INFINITY;
         }
         
-        double distance = (point - p).dot(normal) / sin;
+        real distance = (point - p).dot(normal) / sin;
+
+        return (distance >= 0)? Intersection(distance, this, normal, material) : INFINITY;
+    }
 
-        return (distance >= 0)? Intersection(distance, this) : INFINITY;
+    bool occluded(const Vector3 &p, const Vector3 &v, real t_max) const override {
+        real sin = normal.dot(v);
+        if (fabs(sin) <= epsilon) return false;
+        real distance = (point - p).dot(normal) / sin;
+        return distance > epsilon && distance < t_max;
     }
 };
 
@@ -74,25 +106,34 @@ class Sphere: public Object {
 
 public:
     Sphere() {}
-    Sphere(Vector3 center, double radius): center {center}, radius {radius} {}
-    Vector3 get_normal(const Vector3 &p) { return (p - center).normalized(); }
+    Sphere(Vector3 center, real radius): center {center}, radius {radius} {}
+    bool get_bounds(BoundingBox &box) const {
+        Vector3 r(radius, radius, radius);
+        box = BoundingBox(center - r, center + r);
+        return true;
+    }
+    bool get_sphere(Vector3 &c, real &r) const {
+        c = center;
+        r = radius;
+        return true;
+    }
     std::string to_string() {
         return "Esfera de centro (" + std::to_string(center.x()) +", "+ std::to_string(center.y()) +", "+ std::to_string(center.z())+")";
         }
-    Intersection raycast(Vector3 p, Vector3 v) {
+    Intersection raycast(const Vector3 &p, const Vector3 &v) const {
         Vector3 d = center - p;
         
-        const double proj_lenght = d.dot(v);
+        const real proj_lenght = d.dot(v);
         
         if (proj_lenght < 0) return INFINITY;
 
-        const double
+        const real
             square_distance = d.sqr_lenght() - (proj_lenght*proj_lenght),
             square_radius = radius*radius;
         
         if (square_distance > square_radius) return INFINITY;
 
-        double
+        real
             half_chord = sqrt(square_radius - square_distance),
 
             d_1 = proj_lenght - half_chord,
@@ -100,38 +141,75 @@ public:
 
         //std::cerr << "Interseção!\n";
 
-        return  (d_1 > 0)? Intersection(d_1, this) :
-                (d_2 > 0)? Intersection(d_2, this) : INFINITY;
+        real dist =   (d_1 > 0)? d_1 :
+                        (d_2 > 0)? d_2 : INFINITY;
+        if (dist == INFINITY) return INFINITY;
+        return Intersection(dist, this, (p + v.normalized() * dist - center).normalized(), material);
 
     }
+    // Qualquer uma das duas raízes no intervalo serve, inclusive com a origem dentro da esfera
+    bool occluded(const Vector3 &p, const Vector3 &v, real t_max) const override {
+        Vector3 d = center - p;
+        const real proj_lenght = d.dot(v);
+        const real discriminant = radius*radius - (d.sqr_lenght() - proj_lenght*proj_lenght);
+        if (discriminant < 0) return false;
+
+        real half_chord = sqrt(discriminant),
+               d_1 = proj_lenght - half_chord,
+               d_2 = proj_lenght + half_chord;
+        return (d_1 > epsilon && d_1 < t_max) || (d_2 > epsilon && d_2 < t_max);
+    }
     Vector3 center;
-    double radius;
+    real radius;
 };
 
+// Triângulo avulso. Guarda cópias dos vértices, então pode ser copiado e movido à vontade;
+// malhas usam a TriangleMesh, que compartilha os vértices por índice.
 class Triangle: public Object {
     public:
-        Triangle(Vector3* v0, Vector3* v1, Vector3* v2) {
+        Triangle(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2) {
             v[0] = v0;
             v[1] = v1;
             v[2] = v2;
-            normal = (*v[1] - *v[0]).cross(*v[2] - *v[0]).normalized();
+            normal = (v[1] - v[0]).cross(v[2] - v[0]).normalized();
         }
-        Vector3 get_normal(const Vector3 &p) { return normal; }
-        Intersection raycast(Vector3 origin, Vector3 direction) {
-            double dist = Plane(*v[0], normal).raycast(origin, direction).distance;
-            if (dist < 0) return INFINITY;
+        bool get_bounds(BoundingBox &box) const {
+            box = BoundingBox();
+            for (int k = 0; k < 3; k++) box.expand(v[k]);
+            return true;
+        }
+        Intersection raycast(const Vector3 &origin, const Vector3 &direction) const {
+            real a, b;
+            real dist = distance(origin, direction, INFINITY, a, b);
+            if (dist == INFINITY) return INFINITY;
+            return Intersection(dist, this, normal, material, a, b);
+        }
+        bool occluded(const Vector3 &origin, const Vector3 &direction, real t_max) const override {
+            real a, b;
+            real dist = distance(origin, direction, t_max, a, b);
+            return dist > epsilon && dist < t_max;
+        }
+        Vector3 v[3];
+        Vector3 normal;
+        std::string to_string() {return "Triangle"; }
+
+    private:
+        // Distância do acerto (ou INFINITY) e coordenadas baricêntricas 'a' e 'b'.
+        // O ponto só é testado no triângulo se o plano for atingido antes de 't_max'.
+        real distance(const Vector3 &origin, const Vector3 &direction, real t_max, real &a, real &b) const {
+            real dist = Plane(v[0], normal).raycast(origin, direction).distance;
+            if (dist < 0 || dist >= t_max) return INFINITY;
             Vector3 P = origin + (direction * dist);
-            const Vector3 &A = *v[0], &B = *v[1], &C = *v[2];
 
             Vector3
-                AB = *v[1] - *v[0],
-                AC = *v[2] - *v[0],
-                AP = P-*v[0];
+                AB = v[1] - v[0],
+                AC = v[2] - v[0],
+                AP = P-v[0];
 
-            double a, b, c;
+            real c;
 
             // # Calcula os coeficientes baricêntricos usando produto escalar
-            double denom = AB.dot(AB) * AC.dot(AC) - AB.dot(AC) * AB.dot(AC);
+            real denom = AB.dot(AB) * AC.dot(AC) - AB.dot(AC) * AB.dot(AC);
             if (fabs(denom) < epsilon) return INFINITY;
             // Triângulo degenerado
 
@@ -139,13 +217,9 @@ class Triangle: public Object {
             b = (AB.dot(AB) * AP.dot(AC) - AB.dot(AC) * AP.dot(AB)) / denom;
             c = 1 - b - a;
 
-
-            if (a >= 0 && b >= 0 && c > 0 && a < 1 && b < 1 && c < 1) return Intersection(dist, this);
+            if (a >= 0 && b >= 0 && c > 0 && a < 1 && b < 1 && c < 1) return dist;
             return INFINITY;
         }
-        Vector3* v[3];
-        Vector3 normal;
-        std::string to_string() {return "Triangle"; }
 
 };
 inline std::ostream& operator<<(std::ostream &os, Object &o) {
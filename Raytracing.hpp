@@ -1,5 +1,8 @@
 #ifndef RAY_TRACING
     #define RAY_TRACING
     #include "Camera.hpp"
+    #include "Scene.hpp"
     #include "TriangleMesh.hpp"
+    #include "Instance.hpp"
+    #include "MeshCache.hpp"
 #endif
\ No newline at end of file
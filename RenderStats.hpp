@@ -0,0 +1,92 @@
+#ifndef RENDER_STATS_HPP
+#define RENDER_STATS_HPP
+#include "Framebuffer.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+// Contadores de um quadro. Durante a renderização cada bloco conta no seu próprio
+// RenderStats, apontado pelo ponteiro thread_local de local(), sem atomics nem travas;
+// ao fim do quadro a Camera soma os blocos. Com o ponteiro nulo (coleta desligada) cada
+// contador custa um teste; compilando com -DRT_NO_STATS a instrumentação some.
+struct RenderStats {
+    uint64_t primary_rays = 0;
+    uint64_t shadow_rays = 0;
+    uint64_t reflection_rays = 0;
+    uint64_t refraction_rays = 0;
+    uint64_t refined_pixels = 0; // pixels refeitos pelo antisserrilhamento adaptativo
+    uint64_t object_tests = 0;   // raycast/occluded em objetos da cena, por raio
+    uint64_t triangle_tests = 0; // triângulos testados dentro das malhas, por raio
+    double seconds = 0;
+
+#ifdef RT_NO_STATS
+    static constexpr bool compiled_in = false;
+#else
+    static constexpr bool compiled_in = true;
+#endif
+
+    uint64_t rays() const { return primary_rays + shadow_rays + reflection_rays + refraction_rays; }
+    uint64_t tests() const { return object_tests + triangle_tests; }
+
+    RenderStats& operator +=(const RenderStats &other) {
+        primary_rays += other.primary_rays;
+        shadow_rays += other.shadow_rays;
+        reflection_rays += other.reflection_rays;
+        refraction_rays += other.refraction_rays;
+        refined_pixels += other.refined_pixels;
+        object_tests += other.object_tests;
+        triangle_tests += other.triangle_tests;
+        return *this;
+    }
+
+    // Contadores em uso pela thread atual (nulo se não há coleta)
+    static RenderStats*& local() {
+        static thread_local RenderStats *current = nullptr;
+        return current;
+    }
+
+    void print(std::ostream &os) const {
+        os << "Estatísticas do quadro (" << seconds << " s):\n"
+           << "  raios primários:     " << primary_rays << "\n"
+           << "  raios de sombra:     " << shadow_rays << "\n"
+           << "  raios de reflexão:   " << reflection_rays << "\n"
+           << "  raios de refração:   " << refraction_rays << "\n"
+           << "  pixels refinados:    " << refined_pixels << "\n"
+           << "  testes de objetos:   " << object_tests << "\n"
+           << "  testes de triângulos: " << triangle_tests << "\n";
+        if (seconds > 0) os << "  raios por segundo:   " << rays() / seconds << "\n";
+        if (rays() > 0) os << "  testes por raio:     " << (double) tests() / rays() << "\n";
+    }
+
+    // Mapa de calor do custo por pixel: preto (barato) → azul → vermelho → amarelo → branco.
+    // A escala vai até o percentil 99 para que poucos pixels caros não escureçam o resto.
+    static Framebuffer heatmap(const std::vector<uint32_t> &cost, int width, int height) {
+        Framebuffer image(width, height);
+        if (cost.empty()) return image;
+        std::vector<uint32_t> sorted(cost);
+        size_t k = sorted.size() * 99 / 100;
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        double top = std::max<uint32_t>(1, sorted[k]);
+
+        static const Color stops[] = {
+            Color(0, 0, 0), Color(0, 0, 1), Color(1, 0, 0), Color(1, 1, 0), Color(1, 1, 1)
+        };
+        const int last = sizeof(stops) / sizeof(stops[0]) - 1;
+        for (size_t i = 0; i < cost.size(); i++) {
+            double t = std::min(1.0, cost[i] / top) * last;
+            int s = std::min(last - 1, (int) t);
+            double f = t - s;
+            image.pixels[i] = stops[s] * (real) (1 - f) + stops[s + 1] * (real) f;
+        }
+        return image;
+    }
+};
+
+#ifdef RT_NO_STATS
+    #define RT_STAT(counter, n) ((void) 0)
+#else
+    #define RT_STAT(counter, n) do { if (RenderStats *stats_ = RenderStats::local()) stats_->counter += (n); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+#include "Vector3.hpp"
+#include "BoundingBox.hpp"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Escolha do conjunto de instruções em tempo de compilação: AVX (4 doubles por registro),
+// SSE2 (2 registros de 2 doubles) ou código escalar. Defina RT_NO_SIMD para forçar o escalar.
+#if !defined(RT_NO_SIMD) && defined(__AVX__)
+    #include <immintrin.h>
+    #define RT_SIMD_AVX
+#elif !defined(RT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #include <emmintrin.h>
+    #define RT_SIMD_SSE2
+#endif
+
+inline const char* simd_isa() {
+#if defined(RT_SIMD_AVX)
+    return "avx";
+#elif defined(RT_SIMD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// Quatro doubles processados juntos. Comparações devolvem máscaras (todos os bits
+// ligados na faixa verdadeira), combinadas com & e | e lidas com movemask().
+// load() também aceita floats, alargados para double: os blocos guardam 'real',
+// mas as contas vetoriais são sempre em double.
+struct double4 {
+#if defined(RT_SIMD_AVX)
+    __m256d v;
+    double4() {}
+    double4(__m256d v): v {v} {}
+    double4(double k): v {_mm256_set1_pd(k)} {}
+    static inline double4 load(const double *p) { return _mm256_load_pd(p); }
+    static inline double4 load(const float *p) { return _mm256_cvtps_pd(_mm_load_ps(p)); }
+    inline void store(double *p) const { _mm256_store_pd(p, v); }
+    friend inline double4 operator +(double4 a, double4 b) { return _mm256_add_pd(a.v, b.v); }
+    friend inline double4 operator -(double4 a, double4 b) { return _mm256_sub_pd(a.v, b.v); }
+    friend inline double4 operator *(double4 a, double4 b) { return _mm256_mul_pd(a.v, b.v); }
+    friend inline double4 operator /(double4 a, double4 b) { return _mm256_div_pd(a.v, b.v); }
+    friend inline double4 operator &(double4 a, double4 b) { return _mm256_and_pd(a.v, b.v); }
+    friend inline double4 operator |(double4 a, double4 b) { return _mm256_or_pd(a.v, b.v); }
+    friend inline double4 operator <(double4 a, double4 b)  { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+    friend inline double4 operator <=(double4 a, double4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ); }
+    friend inline double4 operator >(double4 a, double4 b)  { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+    friend inline double4 operator >=(double4 a, double4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ); }
+    friend inline int movemask(double4 m) { return _mm256_movemask_pd(m.v); }
+    // Escolhe 'b' nas faixas em que 'mask' é verdadeira e 'a' nas demais
+    friend inline double4 blend(double4 a, double4 b, double4 mask) { return _mm256_blendv_pd(a.v, b.v, mask.v); }
+    friend inline double4 abs(double4 a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+    friend inline double4 sqrt(double4 a) { return _mm256_sqrt_pd(a.v); }
+#elif defined(RT_SIMD_SSE2)
+    __m128d lo, hi;
+    double4() {}
+    double4(__m128d lo, __m128d hi): lo {lo}, hi {hi} {}
+    double4(double k): lo {_mm_set1_pd(k)}, hi {_mm_set1_pd(k)} {}
+    static inline double4 load(const double *p) { return double4(_mm_load_pd(p), _mm_load_pd(p + 2)); }
+    static inline double4 load(const float *p) { __m128 f = _mm_load_ps(p); return double4(_mm_cvtps_pd(f), _mm_cvtps_pd(_mm_movehl_ps(f, f))); }
+    inline void store(double *p) const { _mm_store_pd(p, lo); _mm_store_pd(p + 2, hi); }
+    friend inline double4 operator +(double4 a, double4 b) { return double4(_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)); }
+    friend inline double4 operator -(double4 a, double4 b) { return double4(_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)); }
+    friend inline double4 operator *(double4 a, double4 b) { return double4(_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)); }
+    friend inline double4 operator /(double4 a, double4 b) { return double4(_mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi)); }
+    friend inline double4 operator &(double4 a, double4 b) { return double4(_mm_and_pd(a.lo, b.lo), _mm_and_pd(a.hi, b.hi)); }
+    friend inline double4 operator |(double4 a, double4 b) { return double4(_mm_or_pd(a.lo, b.lo), _mm_or_pd(a.hi, b.hi)); }
+    friend inline double4 operator <(double4 a, double4 b)  { return double4(_mm_cmplt_pd(a.lo, b.lo), _mm_cmplt_pd(a.hi, b.hi)); }
+    friend inline double4 operator <=(double4 a, double4 b) { return double4(_mm_cmple_pd(a.lo, b.lo), _mm_cmple_pd(a.hi, b.hi)); }
+    friend inline double4 operator >(double4 a, double4 b)  { return double4(_mm_cmpgt_pd(a.lo, b.lo), _mm_cmpgt_pd(a.hi, b.hi)); }
+    friend inline double4 operator >=(double4 a, double4 b) { return double4(_mm_cmpge_pd(a.lo, b.lo), _mm_cmpge_pd(a.hi, b.hi)); }
+    friend inline int movemask(double4 m) { return _mm_movemask_pd(m.lo) | (_mm_movemask_pd(m.hi) << 2); }
+    friend inline double4 blend(double4 a, double4 b, double4 mask) {
+        return double4(_mm_or_pd(_mm_and_pd(mask.lo, b.lo), _mm_andnot_pd(mask.lo, a.lo)),
+                       _mm_or_pd(_mm_and_pd(mask.hi, b.hi), _mm_andnot_pd(mask.hi, a.hi)));
+    }
+    friend inline double4 abs(double4 a) {
+        __m128d sign = _mm_set1_pd(-0.0);
+        return double4(_mm_andnot_pd(sign, a.lo), _mm_andnot_pd(sign, a.hi));
+    }
+    friend inline double4 sqrt(double4 a) { return double4(_mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi)); }
+#else
+    double v[4];
+    double4() {}
+    double4(double k) { v[0] = v[1] = v[2] = v[3] = k; }
+    static inline double4 load(const double *p) { double4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+    static inline double4 load(const float *p) { double4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+    inline void store(double *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+
+    #define RT_LANEWISE(op) \
+        friend inline double4 operator op(double4 a, double4 b) { double4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] op b.v[i]; return r; }
+    RT_LANEWISE(+) RT_LANEWISE(-) RT_LANEWISE(*) RT_LANEWISE(/)
+    #undef RT_LANEWISE
+
+    static inline double4 from_bool(const bool b[4]) {
+        double4 r;
+        uint64_t ones = ~(uint64_t) 0, zero = 0;
+        for (int i = 0; i < 4; i++) memcpy(&r.v[i], b[i]? &ones : &zero, sizeof(double));
+        return r;
+    }
+    inline bool lane(int i) const { uint64_t bits; memcpy(&bits, &v[i], sizeof(double)); return bits != 0; }
+
+    #define RT_COMPARE(op) \
+        friend inline double4 operator op(double4 a, double4 b) { bool r[4]; for (int i = 0; i < 4; i++) r[i] = a.v[i] op b.v[i]; return from_bool(r); }
+    RT_COMPARE(<) RT_COMPARE(<=) RT_COMPARE(>) RT_COMPARE(>=)
+    #undef RT_COMPARE
+
+    friend inline double4 operator &(double4 a, double4 b) { bool r[4]; for (int i = 0; i < 4; i++) r[i] = a.lane(i) && b.lane(i); return from_bool(r); }
+    friend inline double4 operator |(double4 a, double4 b) { bool r[4]; for (int i = 0; i < 4; i++) r[i] = a.lane(i) || b.lane(i); return from_bool(r); }
+    friend inline int movemask(double4 m) { int r = 0; for (int i = 0; i < 4; i++) r |= m.lane(i) << i; return r; }
+    friend inline double4 blend(double4 a, double4 b, double4 mask) { double4 r; for (int i = 0; i < 4; i++) r.v[i] = mask.lane(i)? b.v[i] : a.v[i]; return r; }
+    friend inline double4 abs(double4 a) { double4 r; for (int i = 0; i < 4; i++) r.v[i] = fabs(a.v[i]); return r; }
+    friend inline double4 sqrt(double4 a) { double4 r; for (int i = 0; i < 4; i++) r.v[i] = ::sqrt(a.v[i]); return r; }
+#endif
+};
+
+// Número de faixas ligadas numa máscara de quatro faixas
+inline int lane_count(int mask) {
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+// Vetor 3D com quatro valores por componente (estrutura de arrays)
+struct Vector3x4 {
+    double4 x, y, z;
+    Vector3x4() {}
+    Vector3x4(double4 x, double4 y, double4 z): x {x}, y {y}, z {z} {}
+    Vector3x4(const Vector3 &v): x {v.x()}, y {v.y()}, z {v.z()} {}
+};
+
+inline Vector3x4 operator -(const Vector3x4 &a, const Vector3x4 &b) { return Vector3x4(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline double4 dot(const Vector3x4 &a, const Vector3x4 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vector3x4 cross(const Vector3x4 &a, const Vector3x4 &b) {
+    return Vector3x4(a.y * b.z - a.z * b.y,
+                     a.z * b.x - a.x * b.z,
+                     a.x * b.y - a.y * b.x);
+}
+
+// Möller–Trumbore em quatro faixas, com as mesmas operações e na mesma ordem do
+// teste escalar de TriangleMesh. Serve tanto para 1 raio x 4 triângulos quanto
+// para 4 raios x 1 triângulo, conforme o que for replicado nas faixas.
+// Retorna a máscara das faixas atingidas com distância em [0, t_max].
+inline int intersect_triangles(const Vector3x4 &origin, const Vector3x4 &direction,
+                               const Vector3x4 &v0, const Vector3x4 &edge1, const Vector3x4 &edge2,
+                               double4 t_max, double4 &dist, double4 &u, double4 &v) {
+    Vector3x4 p = cross(direction, edge2);
+    double4 det = dot(edge1, p);
+    double4 inv_det = double4(1.0) / det;
+
+    Vector3x4 s = origin - v0;
+    u = dot(s, p) * inv_det;
+    Vector3x4 q = cross(s, edge1);
+    v = dot(direction, q) * inv_det;
+    dist = dot(edge2, q) * inv_det;
+
+    double4 mask = (abs(det) >= double4(1.0E-12)) &
+                   (u >= double4(0.0)) & (u <= double4(1.0)) &
+                   (v >= double4(0.0)) & (u + v <= double4(1.0)) &
+                   (dist >= double4(0.0)) & (dist <= t_max);
+    return movemask(mask);
+}
+
+// Mesmo teste da classe Sphere, em quatro faixas. Retorna a máscara dos acertos
+// e a distância (a primeira positiva entre as duas raízes) em 'dist'.
+inline int intersect_spheres(const Vector3x4 &origin, const Vector3x4 &direction,
+                             const Vector3x4 &center, double4 square_radius, double4 &dist) {
+    Vector3x4 d = center - origin;
+    double4 proj_lenght = dot(d, direction);
+    double4 square_distance = dot(d, d) - proj_lenght * proj_lenght;
+    double4 half_chord = sqrt(abs(square_radius - square_distance));
+    double4 d_1 = proj_lenght - half_chord;
+    double4 d_2 = proj_lenght + half_chord;
+
+    double4 zero(0.0);
+    double4 first_positive = d_1 > zero;
+    double4 valid = (proj_lenght >= zero) & (square_distance <= square_radius) & (first_positive | (d_2 > zero));
+    dist = blend(d_2, d_1, first_positive);
+    return movemask(valid);
+}
+
+// Mesmo teste de Sphere::occluded em quatro faixas: máscara das esferas com alguma
+// das duas raízes em (t_min, t_max), inclusive com a origem dentro da esfera
+inline int occluded_spheres(const Vector3x4 &origin, const Vector3x4 &direction,
+                            const Vector3x4 &center, double4 square_radius, double4 t_min, double4 t_max) {
+    Vector3x4 d = center - origin;
+    double4 proj_lenght = dot(d, direction);
+    double4 discriminant = square_radius - (dot(d, d) - proj_lenght * proj_lenght);
+    double4 half_chord = sqrt(abs(discriminant));
+    double4 d_1 = proj_lenght - half_chord;
+    double4 d_2 = proj_lenght + half_chord;
+    double4 valid = (discriminant >= double4(0.0)) &
+                    (((d_1 > t_min) & (d_1 < t_max)) | ((d_2 > t_min) & (d_2 < t_max)));
+    return movemask(valid);
+}
+
+// Quatro triângulos de uma folha da BVH, como índices num buffer de vértices compartilhado.
+// Os vértices de cada faixa são reunidos em estrutura de arrays e as arestas calculadas
+// a cada teste, com as mesmas operações de quem as pré-calculava.
+struct Triangle4 {
+    int v[3][4];  // índices dos três vértices em cada faixa; 0 nas faixas vazias
+    int count;
+
+    Triangle4(): count {0} {
+        for (int k = 0; k < 3; k++)
+            for (int i = 0; i < 4; i++) v[k][i] = 0;
+    }
+
+    void set(int lane, int a, int b, int c) {
+        v[0][lane] = a;
+        v[1][lane] = b;
+        v[2][lane] = c;
+    }
+
+    Vector3 get_v0(const Vector3 *vertices, int lane) const { return vertices[v[0][lane]]; }
+    Vector3 get_edge1(const Vector3 *vertices, int lane) const { return vertices[v[1][lane]] - vertices[v[0][lane]]; }
+    Vector3 get_edge2(const Vector3 *vertices, int lane) const { return vertices[v[2][lane]] - vertices[v[0][lane]]; }
+
+    // Um raio contra os quatro triângulos; faixas vazias nunca são atingidas
+    inline int intersect(const Vector3 *vertices, const Vector3 &origin, const Vector3 &direction, double t_max,
+                         double dist[4], double u[4], double w[4]) const {
+        alignas(32) double a[3][4], e1[3][4], e2[3][4];
+        for (int lane = 0; lane < 4; lane++) {
+            const Vector3 &p0 = vertices[v[0][lane]];
+            Vector3 edge1 = vertices[v[1][lane]] - p0, edge2 = vertices[v[2][lane]] - p0;
+            for (int k = 0; k < 3; k++) {
+                a[k][lane] = p0[k];
+                e1[k][lane] = edge1[k];
+                e2[k][lane] = edge2[k];
+            }
+        }
+        Vector3x4 av(double4::load(a[0]), double4::load(a[1]), double4::load(a[2]));
+        Vector3x4 e1v(double4::load(e1[0]), double4::load(e1[1]), double4::load(e1[2]));
+        Vector3x4 e2v(double4::load(e2[0]), double4::load(e2[1]), double4::load(e2[2]));
+        double4 d, uu, vv;
+        int mask = intersect_triangles(Vector3x4(origin), Vector3x4(direction), av, e1v, e2v, double4(t_max), d, uu, vv);
+        d.store(dist);
+        uu.store(u);
+        vv.store(w);
+        return mask & ((1 << count) - 1);
+    }
+};
+
+// Quatro esferas em estrutura de arrays, na precisão 'real'
+struct alignas(32) Sphere4 {
+    real center[3][4];
+    real square_radius[4];
+    int id[4];  // índice da esfera de origem em cada faixa, -1 nas faixas vazias
+    int count;
+
+    Sphere4(): count {0} {
+        for (int i = 0; i < 4; i++) {
+            center[0][i] = center[1][i] = center[2][i] = 0;
+            square_radius[i] = 0;
+            id[i] = -1;
+        }
+    }
+
+    void set(int lane, int sphere_id, const Vector3 &c, real radius) {
+        for (int k = 0; k < 3; k++) center[k][lane] = c[k];
+        square_radius[lane] = radius * radius;
+        id[lane] = sphere_id;
+    }
+
+    inline int intersect(const Vector3 &origin, const Vector3 &direction, double dist[4]) const {
+        Vector3x4 c(double4::load(center[0]), double4::load(center[1]), double4::load(center[2]));
+        double4 d;
+        int mask = intersect_spheres(Vector3x4(origin), Vector3x4(direction), c, double4::load(square_radius), d);
+        d.store(dist);
+        return mask & ((1 << count) - 1);
+    }
+
+    inline int occluded(const Vector3 &origin, const Vector3 &direction, double t_min, double t_max) const {
+        Vector3x4 c(double4::load(center[0]), double4::load(center[1]), double4::load(center[2]));
+        int mask = occluded_spheres(Vector3x4(origin), Vector3x4(direction), c, double4::load(square_radius),
+                                    double4(t_min), double4(t_max));
+        return mask & ((1 << count) - 1);
+    }
+};
+
+// Pacote de quatro raios coerentes (por exemplo, um bloco 2x2 de raios primários), na precisão 'real'
+struct alignas(32) RayPacket4 {
+    real origin[3][4];
+    real direction[3][4];
+    real inv_direction[3][4];
+    int active; // máscara das faixas em uso
+
+    RayPacket4(): active {0} {
+        for (int k = 0; k < 3; k++)
+            for (int i = 0; i < 4; i++) origin[k][i] = direction[k][i] = inv_direction[k][i] = 0;
+    }
+
+    void set(int lane, const Vector3 &o, const Vector3 &d) {
+        for (int k = 0; k < 3; k++) {
+            origin[k][lane] = o[k];
+            direction[k][lane] = d[k];
+            inv_direction[k][lane] = 1.0 / d[k];
+        }
+        active |= 1 << lane;
+    }
+
+    Vector3 get_origin(int lane) const { return Vector3(origin[0][lane], origin[1][lane], origin[2][lane]); }
+    Vector3 get_direction(int lane) const { return Vector3(direction[0][lane], direction[1][lane], direction[2][lane]); }
+
+    inline Vector3x4 origins() const { return Vector3x4(double4::load(origin[0]), double4::load(origin[1]), double4::load(origin[2])); }
+    inline Vector3x4 directions() const { return Vector3x4(double4::load(direction[0]), double4::load(direction[1]), double4::load(direction[2])); }
+
+    // Teste de slabs dos quatro raios contra uma caixa, com o mesmo tratamento de NaN
+    // de BoundingBox::hit. Retorna a máscara das faixas que atingem a caixa em [0, t_max].
+    inline int hit(const BoundingBox &box, const double t_max[4], double t_near[4]) const {
+        double4 t0(0.0), t1 = double4::load(t_max);
+        for (int k = 0; k < 3; k++) {
+            double4 o = double4::load(origin[k]), inv = double4::load(inv_direction[k]);
+            double4 a = (double4(box.min[k]) - o) * inv;
+            double4 b = (double4(box.max[k]) - o) * inv;
+            double4 swap = a > b;
+            double4 near = blend(a, b, swap), far = blend(b, a, swap);
+            t0 = blend(t0, near, near > t0);
+            t1 = blend(t1, far, far < t1);
+        }
+        t0.store(t_near);
+        return movemask(t0 <= t1) & active;
+    }
+};
+
+#endif
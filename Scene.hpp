@@ -0,0 +1,242 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+#include "Object.hpp"
+#include "Arena.hpp"
+#include "BVH.hpp"
+#include "RenderStats.hpp"
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+// Estrutura de aceleração de dois níveis: a cena mantém uma BVH sobre as caixas
+// dos objetos limitados (nível superior) e uma lista separada para os ilimitados,
+// como planos. Cada objeto pode ter sua própria estrutura interna (nível inferior),
+// como a BVH da TriangleMesh, acessada pelo seu raycast. As esferas simples de cada
+// folha são testadas juntas, de 4 em 4, com Sphere4.
+//
+// Os objetos podem pertencer a quem chama (add) ou à própria cena (create e
+// create_material), que os guarda contíguos na sua arena, com endereços estáveis
+// mesmo quando a cena é movida, e os libera todos de uma vez em clear() ou no destrutor.
+class Scene {
+    public:
+        std::vector<Object*> objects;
+
+        Scene() {}
+        Scene(const std::vector<Object*> &objects) {
+            for (Object* o : objects) add(o);
+            build();
+        }
+
+        void add(Object* o) { objects.push_back(o); }
+
+        // Cria um objeto na arena da cena e o adiciona
+        template <typename T, typename... Args>
+        T* create(Args&&... args) {
+            T *o = arena.create<T>(std::forward<Args>(args)...);
+            add(o);
+            return o;
+        }
+
+        // Material que vive tanto quanto a cena
+        Object::Material* create_material(const Object::Material &m = Object::Material()) {
+            return arena.create<Object::Material>(m);
+        }
+
+        // Remove todos os objetos e libera, de uma vez, os que a cena criou
+        void clear() {
+            objects.clear();
+            bounded.clear();
+            unbounded.clear();
+            bvh.build(std::vector<BoundingBox>());
+            sphere_blocks.clear();
+            leaf_spheres.assign(1, 0);
+            in_block.clear();
+            arena.release();
+        }
+
+        // Memória ocupada pelos objetos e materiais criados pela cena
+        size_t arena_bytes() const { return arena.bytes_reserved(); }
+
+        // Deve ser chamada depois de adicionar objetos e antes de renderizar
+        void build() {
+            bounded.clear();
+            unbounded.clear();
+            std::vector<BoundingBox> object_bounds;
+            // Esferas simples vão para os blocos Sphere4. Com RT_FLOAT o teste do bloco (sempre
+            // em double) poderia discordar do raycast da esfera, então elas ficam de fora.
+            bool batch = sizeof(real) == sizeof(double);
+            std::vector<Vector3> centers;
+            std::vector<real> radii;
+            in_block.clear();
+            for (size_t i = 0; i < objects.size(); i++) {
+                BoundingBox box;
+                if (objects[i]->get_bounds(box)) {
+                    bounded.push_back((int) i);
+                    object_bounds.push_back(box);
+                    Vector3 center;
+                    real radius = 0;
+                    in_block.push_back(batch && objects[i]->get_sphere(center, radius));
+                    centers.push_back(center);
+                    radii.push_back(radius);
+                } else {
+                    unbounded.push_back((int) i);
+                }
+            }
+            // Só com esferas as folhas são cobradas por bloco; com outros objetos nas folhas
+            // isso juntaria malhas e instâncias inteiras numa folha só
+            bool only_spheres = std::find(in_block.begin(), in_block.end(), false) == in_block.end();
+            bvh.leaf_width = only_spheres? 4 : 1;
+            bvh.build(object_bounds);
+
+            // Agrupa as esferas de cada folha em blocos para o teste vetorizado
+            sphere_blocks.clear();
+            leaf_spheres.assign(bvh.nodes.size() + 1, 0);
+            for (size_t n = 0; n < bvh.nodes.size(); n++) {
+                leaf_spheres[n] = (int) sphere_blocks.size();
+                const BVH::Node &node = bvh.nodes[n];
+                for (int k = node.first; node.is_leaf() && k < node.first + node.count; k++) {
+                    int b = bvh.indices[k];
+                    if (!in_block[b]) continue;
+                    if ((int) sphere_blocks.size() == leaf_spheres[n] || sphere_blocks.back().count == 4) {
+                        sphere_blocks.push_back(Sphere4());
+                    }
+                    Sphere4 &block = sphere_blocks.back();
+                    block.set(block.count++, bounded[b], centers[b], radii[b]);
+                }
+            }
+            leaf_spheres.back() = (int) sphere_blocks.size();
+        }
+
+        // Acerto mais próximo com distância maior que epsilon.
+        // Em empates vence o objeto adicionado primeiro, como no laço linear sobre 'objects'.
+        Object::Intersection raycast(const Vector3 &p, const Vector3 &v) const {
+            double min_dist = INFINITY;
+            Object::Intersection closest(INFINITY);
+            int hit_index = -1;
+            bool sphere_hit = false; // o mais próximo saiu de um bloco e ainda não tem o registro completo
+
+            auto test = [&](int i, double &t_max) {
+                RT_STAT(object_tests, 1);
+                Object::Intersection hit = objects[i]->raycast(p, v);
+                double dist = hit.distance;
+                if (dist <= epsilon || dist == INFINITY) return;
+                if (dist < t_max || (dist == t_max && i < hit_index)) {
+                    t_max = dist;
+                    closest = hit;
+                    hit_index = i;
+                    sphere_hit = false;
+                }
+            };
+
+            for (int i : unbounded) test(i, min_dist);
+            bvh.intersect_leaves(p, v, min_dist, [&](int node, double &t_max) {
+                const BVH::Node &leaf = bvh.nodes[node];
+                for (int k = leaf.first; k < leaf.first + leaf.count; k++) {
+                    if (!in_block[bvh.indices[k]]) test(bounded[bvh.indices[k]], t_max);
+                }
+                intersect_spheres(node, p, v, t_max, hit_index, sphere_hit);
+            });
+
+            // Normal e material da esfera vencedora vêm do seu próprio raycast
+            if (sphere_hit) closest = objects[hit_index]->raycast(p, v);
+            return closest;
+        }
+
+        // Versão em pacote de raycast, com as mesmas regras por faixa.
+        // Faixas inativas de 'rays' recebem Intersection() (distância infinita).
+        void raycast_packet(const RayPacket4 &rays, Object::Intersection hits[4]) const {
+            alignas(32) double min_dist[4] = {INFINITY, INFINITY, INFINITY, INFINITY};
+            int hit_index[4] = {-1, -1, -1, -1};
+            bool sphere_hit[4] = {false, false, false, false};
+            for (int lane = 0; lane < 4; lane++) hits[lane] = Object::Intersection();
+
+            auto test = [&](int i, int mask) {
+                RT_STAT(object_tests, lane_count(mask));
+                Object::Intersection lane_hits[4];
+                objects[i]->raycast_packet(rays, mask, lane_hits);
+                for (int lane = 0; lane < 4; lane++) {
+                    if (!(mask & (1 << lane))) continue;
+                    double dist = lane_hits[lane].distance;
+                    if (dist <= epsilon || dist == INFINITY) continue;
+                    if (dist < min_dist[lane] || (dist == min_dist[lane] && i < hit_index[lane])) {
+                        min_dist[lane] = dist;
+                        hits[lane] = lane_hits[lane];
+                        hit_index[lane] = i;
+                        sphere_hit[lane] = false;
+                    }
+                }
+            };
+
+            for (int i : unbounded) test(i, rays.active);
+            bvh.intersect_packet_leaves(rays, min_dist, [&](int node, int mask) {
+                const BVH::Node &leaf = bvh.nodes[node];
+                for (int k = leaf.first; k < leaf.first + leaf.count; k++) {
+                    if (!in_block[bvh.indices[k]]) test(bounded[bvh.indices[k]], mask);
+                }
+                // As esferas não têm teste de pacote: cada faixa testa os blocos da folha
+                for (int lane = 0; lane < 4 && leaf_spheres[node] < leaf_spheres[node + 1]; lane++) {
+                    if (mask & (1 << lane)) {
+                        intersect_spheres(node, rays.get_origin(lane), rays.get_direction(lane), min_dist[lane], hit_index[lane], sphere_hit[lane]);
+                    }
+                }
+            });
+            for (int lane = 0; lane < 4; lane++) {
+                if (sphere_hit[lane]) hits[lane] = objects[hit_index[lane]]->raycast(rays.get_origin(lane), rays.get_direction(lane));
+            }
+        }
+
+        // Verdadeiro se algum objeto for atingido entre epsilon e t_max (v normalizado).
+        // Para no primeiro objeto que bloqueia o raio; a BVH só visita caixas antes de t_max.
+        bool occluded(const Vector3 &p, const Vector3 &v, real t_max) const {
+            auto test = [&](int i) {
+                RT_STAT(object_tests, 1);
+                return objects[i]->occluded(p, v, t_max);
+            };
+            for (int i : unbounded) {
+                if (test(i)) return true;
+            }
+            return bvh.any_leaf(p, v, t_max, [&](int node) {
+                const BVH::Node &leaf = bvh.nodes[node];
+                for (int k = leaf.first; k < leaf.first + leaf.count; k++) {
+                    if (!in_block[bvh.indices[k]] && test(bounded[bvh.indices[k]])) return true;
+                }
+                for (int s = leaf_spheres[node]; s < leaf_spheres[node + 1]; s++) {
+                    RT_STAT(object_tests, sphere_blocks[s].count);
+                    if (sphere_blocks[s].occluded(p, v, epsilon, t_max)) return true;
+                }
+                return false;
+            });
+        }
+
+    private:
+        // Testa os blocos de esferas da folha 'node' contra o raio (p, v), com as regras de raycast.
+        // Um acerto mais próximo atualiza t_max e hit_index e marca sphere_hit.
+        void intersect_spheres(int node, const Vector3 &p, const Vector3 &v, double &t_max, int &hit_index, bool &sphere_hit) const {
+            for (int s = leaf_spheres[node]; s < leaf_spheres[node + 1]; s++) {
+                const Sphere4 &block = sphere_blocks[s];
+                RT_STAT(object_tests, block.count);
+                alignas(32) double dist[4];
+                int mask = block.intersect(p, v, dist);
+                for (int lane = 0; mask; lane++, mask >>= 1) {
+                    if (!(mask & 1) || dist[lane] <= epsilon) continue;
+                    int i = block.id[lane];
+                    if (dist[lane] < t_max || (dist[lane] == t_max && i < hit_index)) {
+                        t_max = dist[lane];
+                        hit_index = i;
+                        sphere_hit = true;
+                    }
+                }
+            }
+        }
+
+        Arena arena;
+        BVH bvh;
+        std::vector<int> bounded;
+        std::vector<int> unbounded;
+        // Esferas das folhas de 4 em 4; as do nó n ficam em [leaf_spheres[n], leaf_spheres[n + 1])
+        std::vector<Sphere4> sphere_blocks;
+        std::vector<int> leaf_spheres;
+        std::vector<bool> in_block; // por primitiva da BVH: testada num bloco, não pelo raycast
+};
+
+#endif
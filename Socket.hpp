@@ -0,0 +1,167 @@
+#ifndef SOCKET_HPP
+#define SOCKET_HPP
+#include "ImageWriter.hpp"
+#include <errno.h>
+#include <string.h>
+#include <string>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Funções mínimas sobre sockets para o servidor e a renderização distribuída. Só POSIX.
+// Um endereço "host:porta" é TCP; qualquer outro é o caminho de um socket UNIX local.
+// As mensagens de controle são linhas de texto; imagens vão como bytes crus.
+namespace Socket {
+
+    // Envia todos os 'n' bytes, repetindo as escritas parciais
+    inline bool send_all(int fd, const void *data, size_t n) {
+        const char *p = (const char*) data;
+        while (n > 0) {
+            ssize_t sent = ::send(fd, p, n, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) return false;
+            p += sent;
+            n -= sent;
+        }
+        return true;
+    }
+
+    inline bool send_line(int fd, const std::string &line) {
+        std::string l = line + "\n";
+        return send_all(fd, l.data(), l.size());
+    }
+
+    // Recebe exatamente 'n' bytes; false se a conexão fechar antes
+    inline bool recv_all(int fd, void *data, size_t n) {
+        char *p = (char*) data;
+        while (n > 0) {
+            ssize_t got = ::recv(fd, p, n, 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            p += got;
+            n -= got;
+        }
+        return true;
+    }
+
+    // Lê uma linha (sem o '\n'). Lê byte a byte para não consumir os dados binários
+    // que podem vir logo depois; as linhas de controle são curtas.
+    inline bool recv_line(int fd, std::string &line, size_t max_length = 1 << 16) {
+        line.clear();
+        char c;
+        while (recv_all(fd, &c, 1)) {
+            if (c == '\n') return true;
+            if (line.size() >= max_length) return false;
+            line += c;
+        }
+        return false;
+    }
+
+    inline bool unix_address(const std::string &path, sockaddr_un &address) {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        memcpy(address.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+    // Cria o socket em 'path' (removendo um arquivo antigo) e começa a escutar. Retorna -1 em erro.
+    inline int listen_unix(const std::string &path, int backlog = 64) {
+        sockaddr_un address;
+        if (!unix_address(path, address)) return -1;
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        ::unlink(path.c_str());
+        if (::bind(fd, (sockaddr*) &address, sizeof(address)) != 0 || ::listen(fd, backlog) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    inline int connect_unix(const std::string &path) {
+        sockaddr_un address;
+        if (!unix_address(path, address)) return -1;
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (::connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    inline bool is_tcp(const std::string &address) { return address.find(':') != std::string::npos; }
+
+    // Resolve "host:porta" (host vazio = todas as interfaces, para escutar)
+    inline addrinfo* tcp_address(const std::string &address, bool passive) {
+        size_t colon = address.rfind(':');
+        std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+        addrinfo hints, *result = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (passive) hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo(host.empty()? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0) return nullptr;
+        return result;
+    }
+
+    inline int listen_tcp(const std::string &address, int backlog = 64) {
+        addrinfo *info = tcp_address(address, true);
+        if (!info) return -1;
+        int fd = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        int yes = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (fd >= 0 && (::bind(fd, info->ai_addr, info->ai_addrlen) != 0 || ::listen(fd, backlog) != 0)) {
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(info);
+        return fd;
+    }
+
+    // Mensagens curtas de controle não devem esperar o algoritmo de Nagle (sem efeito em sockets UNIX)
+    inline void set_no_delay(int fd) {
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+
+    inline int connect_tcp(const std::string &address) {
+        addrinfo *info = tcp_address(address, false);
+        if (!info) return -1;
+        int fd = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (fd >= 0 && ::connect(fd, info->ai_addr, info->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(info);
+        if (fd >= 0) set_no_delay(fd);
+        return fd;
+    }
+
+    inline int listen_at(const std::string &address) { return is_tcp(address)? listen_tcp(address) : listen_unix(address); }
+    inline int connect_to(const std::string &address) { return is_tcp(address)? connect_tcp(address) : connect_unix(address); }
+
+    // Limite de espera das leituras; uma leitura que estoura falha como conexão perdida
+    inline bool set_timeout(int fd, double seconds) {
+        timeval tv;
+        tv.tv_sec = (time_t) seconds;
+        tv.tv_usec = (suseconds_t) ((seconds - tv.tv_sec) * 1e6);
+        return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
+    }
+}
+
+// Destino de imagem que escreve direto num socket conectado (que não é fechado aqui)
+class SocketSink: public ImageSink {
+    public:
+        SocketSink(int fd): fd {fd} {}
+        bool write(const char *data, size_t n) { return Socket::send_all(fd, data, n); }
+    private:
+        int fd;
+};
+
+#endif
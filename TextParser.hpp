@@ -0,0 +1,153 @@
+#ifndef TEXT_PARSER_HPP
+#define TEXT_PARSER_HPP
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// Leitor de texto linha a linha sobre um buffer (tipicamente um MappedFile),
+// sem alocações: números são convertidos direto do buffer.
+class TextParser {
+    public:
+        const char *cur;
+        const char *end;
+
+        TextParser(const char *begin, const char *end): cur {begin}, end {end} {}
+
+        inline bool at_end() const { return cur >= end; }
+
+        // Espaços, tabulações e '\r' (de arquivos com fim de linha do Windows)
+        inline void skip_spaces() {
+            while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r')) cur++;
+        }
+
+        inline bool end_of_line() {
+            skip_spaces();
+            return cur >= end || *cur == '\n' || *cur == '#';
+        }
+
+        // Avança até o início da próxima linha
+        inline void next_line() {
+            const char *newline = (const char*) memchr(cur, '\n', end - cur);
+            cur = newline? newline + 1 : end;
+        }
+
+        // Consome 'word' se for a próxima palavra da linha (seguida de espaço ou fim de linha)
+        inline bool keyword(const char *word) {
+            skip_spaces();
+            size_t n = strlen(word);
+            if ((size_t) (end - cur) < n || memcmp(cur, word, n) != 0) return false;
+            const char *after = cur + n;
+            if (after < end && !is_space(*after) && *after != '\n') return false;
+            cur = after;
+            return true;
+        }
+
+        // Próxima palavra da linha (por exemplo, o nome de um material)
+        inline std::string word() {
+            skip_spaces();
+            const char *start = cur;
+            while (cur < end && !is_space(*cur) && *cur != '\n') cur++;
+            return std::string(start, cur);
+        }
+
+        // Pula o resto da palavra atual, como o "/vt/vn" depois do índice de uma face
+        inline void skip_word() {
+            while (cur < end && !is_space(*cur) && *cur != '\n') cur++;
+        }
+
+        inline bool parse_int(long &out) {
+            skip_spaces();
+            const char *p = cur;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+            if (p >= end || !is_digit(*p)) return false;
+            long value = 0;
+            while (p < end && is_digit(*p)) value = value * 10 + (*p++ - '0');
+            out = negative? -value : value;
+            cur = p;
+            return true;
+        }
+
+        // Conversão exata pelo caminho rápido de Clinger: com mantissa de até 2^53 e
+        // expoente decimal de até 22, uma única multiplicação ou divisão por potência
+        // de 10 exata já dá o double corretamente arredondado. Os demais casos
+        // (mantissas longas, expoentes grandes, inf/nan) caem no strtod.
+        inline bool parse_double(double &out) {
+            skip_spaces();
+            const char *p = cur;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+            uint64_t mantissa = 0;
+            int digits = 0, exponent = 0;
+            bool any_digit = false;
+            while (p < end && is_digit(*p)) {
+                accumulate(mantissa, digits, *p++);
+                any_digit = true;
+            }
+            if (p < end && *p == '.') {
+                p++;
+                while (p < end && is_digit(*p)) {
+                    accumulate(mantissa, digits, *p++);
+                    exponent--;
+                    any_digit = true;
+                }
+            }
+            if (!any_digit) return parse_fallback(out);
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                const char *q = p + 1;
+                bool negative_exponent = false;
+                if (q < end && (*q == '-' || *q == '+')) negative_exponent = (*q++ == '-');
+                if (q < end && is_digit(*q)) {
+                    int e = 0;
+                    while (q < end && is_digit(*q)) {
+                        if (e < 10000) e = e * 10 + (*q - '0');
+                        q++;
+                    }
+                    exponent += negative_exponent? -e : e;
+                    p = q;
+                }
+            }
+
+            static const double powers_of_ten[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+            if (digits > 19 || mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22) {
+                return parse_fallback(out);
+            }
+            double value = (double) mantissa;
+            value = (exponent < 0)? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+            out = negative? -value : value;
+            cur = p;
+            return true;
+        }
+
+    private:
+        static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+        static inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        // Dígitos depois do primeiro não nulo; acima de 19 a mantissa não cabe mais em 64 bits
+        static inline void accumulate(uint64_t &mantissa, int &digits, char c) {
+            if (mantissa == 0 && c == '0') return;
+            if (++digits <= 19) mantissa = mantissa * 10 + (c - '0');
+        }
+
+        bool parse_fallback(double &out) {
+            char buffer[128];
+            size_t n = 0;
+            while (cur + n < end && n < sizeof(buffer) - 1 && !is_space(cur[n]) && cur[n] != '\n') {
+                buffer[n] = cur[n];
+                n++;
+            }
+            buffer[n] = '\0';
+            char *stop;
+            out = strtod(buffer, &stop);
+            if (stop == buffer) return false;
+            cur += stop - buffer;
+            return true;
+        }
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de threads com roubo de tarefas: cada thread tem sua própria fila,
+// consome do fim dela e, quando fica sem trabalho, rouba do início da fila
+// das outras. Assim tarefas de custo muito diferente se equilibram sozinhas.
+class ThreadPool {
+    public:
+        typedef std::function<void()> Task;
+
+        explicit ThreadPool(int thread_count) {
+            if (thread_count < 1) thread_count = 1;
+            for (int i = 0; i < thread_count; i++) queues.emplace_back(new Queue());
+            for (int i = 0; i < thread_count; i++) workers.emplace_back(&ThreadPool::work, this, i);
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread &t : workers) t.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        int size() const { return (int) workers.size(); }
+
+        // Número de threads a usar quando o usuário pede 0 ("todos os núcleos")
+        static int default_thread_count() {
+            unsigned n = std::thread::hardware_concurrency();
+            return (n > 0)? (int) n : 1;
+        }
+
+        // Distribui as tarefas entre as filas em rodízio
+        void submit(Task task) {
+            unfinished++;
+            Queue &q = *queues[next_queue.fetch_add(1) % queues.size()];
+            {
+                std::lock_guard<std::mutex> lock(q.mutex);
+                q.tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                queued++;
+            }
+            wake.notify_one();
+        }
+
+        // Bloqueia até que todas as tarefas submetidas tenham terminado
+        void wait() {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done.wait(lock, [this] { return unfinished == 0; });
+        }
+
+        // Conjunto de tarefas que pode ser esperado sozinho, sem esperar as que outros
+        // usuários do mesmo pool submeteram. wait() não pode ser chamado de dentro do pool.
+        class Group {
+            public:
+                explicit Group(ThreadPool &pool): pool {pool} {}
+                ~Group() { wait(); }
+
+                void submit(Task task) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        pending++;
+                    }
+                    pool.submit([this, task] {
+                        task();
+                        // A contagem e o aviso ficam sob a trava: wait() só retorna (e o grupo
+                        // só pode ser destruído) depois que esta thread a soltou
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (--pending == 0) done.notify_all();
+                    });
+                }
+
+                void wait() {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait(lock, [this] { return pending == 0; });
+                }
+
+            private:
+                ThreadPool &pool;
+                int pending = 0; // protegido por 'mutex'
+                std::mutex mutex;
+                std::condition_variable done;
+        };
+
+    private:
+        struct Queue {
+            std::deque<Task> tasks;
+            std::mutex mutex;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next_queue {0}; // vários usuários do pool podem submeter ao mesmo tempo
+
+        std::atomic<int> queued {0};
+        std::atomic<int> unfinished {0};
+        bool stopping = false;
+
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        std::mutex done_mutex;
+        std::condition_variable done;
+
+        bool pop(int index, Task &task) {
+            Queue &q = *queues[index];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) return false;
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(int thief, Task &task) {
+            int n = (int) queues.size();
+            for (int k = 1; k < n; k++) {
+                Queue &q = *queues[(thief + k) % n];
+                std::lock_guard<std::mutex> lock(q.mutex);
+                if (q.tasks.empty()) continue;
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        void work(int index) {
+            Task task;
+            while (true) {
+                if (pop(index, task) || steal(index, task)) {
+                    queued--;
+                    task();
+                    task = nullptr;
+                    if (--unfinished == 0) {
+                        std::lock_guard<std::mutex> lock(done_mutex);
+                        done.notify_all();
+                    }
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping && queued == 0) return;
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+#include "Vector3.hpp"
+#include "BoundingBox.hpp"
+#include <math.h>
+
+// Transformação afim: parte linear 3x3 'm' seguida da translação 't' (p' = m·p + t).
+class Transform {
+    public:
+        real m[3][3];
+        Vector3 t;
+
+        Transform(): m {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}} {}
+
+        static Transform translation(const Vector3 &offset) {
+            Transform r;
+            r.t = offset;
+            return r;
+        }
+        static Transform scaling(const Vector3 &factor) {
+            Transform r;
+            for (int i = 0; i < 3; i++) r.m[i][i] = factor[i];
+            return r;
+        }
+        // Rotação de 'angle' radianos em torno do eixo 'axis' (0 = x, 1 = y, 2 = z)
+        static Transform rotation(int axis, real angle) {
+            Transform r;
+            int a = (axis + 1) % 3, b = (axis + 2) % 3;
+            real c = cos(angle), s = sin(angle);
+            r.m[a][a] = c; r.m[a][b] = -s;
+            r.m[b][a] = s; r.m[b][b] = c;
+            return r;
+        }
+
+        // Composição: (*this * other) aplica primeiro 'other' e depois *this
+        Transform operator *(const Transform &other) const {
+            Transform r;
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    r.m[i][j] = m[i][0] * other.m[0][j] + m[i][1] * other.m[1][j] + m[i][2] * other.m[2][j];
+                }
+            }
+            r.t = point(other.t);
+            return r;
+        }
+
+        inline Vector3 vector(const Vector3 &v) const {
+            return Vector3(m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z(),
+                           m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z(),
+                           m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z());
+        }
+        inline Vector3 point(const Vector3 &p) const { return vector(p) + t; }
+
+        // Normais se transformam pela transposta da inversa; aqui 'this' já é a inversa
+        // (a transformação do mundo para o objeto), então basta a transposta
+        inline Vector3 normal_from_inverse(const Vector3 &n) const {
+            return Vector3(m[0][0] * n.x() + m[1][0] * n.y() + m[2][0] * n.z(),
+                           m[0][1] * n.x() + m[1][1] * n.y() + m[2][1] * n.z(),
+                           m[0][2] * n.x() + m[1][2] * n.y() + m[2][2] * n.z());
+        }
+
+        // Inversa pela matriz dos cofatores. A parte linear não pode ser singular.
+        Transform inverse() const {
+            Transform r;
+            real det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                     - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                     + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+            real inv_det = 1 / det;
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    int i1 = (j + 1) % 3, i2 = (j + 2) % 3, j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+                    r.m[i][j] = (m[i1][j1] * m[i2][j2] - m[i1][j2] * m[i2][j1]) * inv_det;
+                }
+            }
+            r.t = -r.vector(t);
+            return r;
+        }
+
+        // Caixa alinhada aos eixos que envolve a caixa 'box' transformada
+        BoundingBox bounds(const BoundingBox &box) const {
+            BoundingBox r;
+            for (int corner = 0; corner < 8; corner++) {
+                r.expand(point(Vector3((corner & 1)? box.max.x() : box.min.x(),
+                                       (corner & 2)? box.max.y() : box.min.y(),
+                                       (corner & 4)? box.max.z() : box.min.z())));
+            }
+            return r;
+        }
+};
+
+#endif
@@ -2,135 +2,262 @@
 #define TRIANGLE_MESH
 #include "Object.hpp"
 #include "MaterialReader.hpp"
-#include <fstream>
-#include <sstream>
+#include "ObjReader.hpp"
+#include "BVH.hpp"
+#include "RenderStats.hpp"
 #include <iostream>
 #include <vector>
-#include <cstdlib> // para std::stoi
 
 class TriangleMesh: public Object {
     public:
-        std::vector<Triangle> triangles;
-        std::vector<Vector3> vertices;
+        // Cada triângulo existe uma vez, em 'blocks': os índices dos seus três vértices em
+        // 'vertices', de 4 em 4 por folha da BVH, na ordem de 'bvh.indices' (que dá o número
+        // do triângulo). A normal é calculada dos vértices no acerto e o material é um índice
+        // em 'face_materials'.
+        Array<Vector3> vertices;
+        Array<int> indices;                 // 3 índices em 'vertices' por triângulo ainda não empacotado
+        Array<int> face_materials;          // por triângulo: índice em 'materials', ou -1 para o material padrão
+        Array<Object::Material> materials;  // tabela de materiais do .mtl
+        BVH bvh;
+        Array<Triangle4> blocks;            // triângulos das folhas da BVH, de 4 em 4
+        Array<int> node_blocks;             // primeiro bloco de cada folha (-1 em nós internos)
+
+        // Malha vazia, para ser preenchida por load_obj ou pelo MeshCache
+        TriangleMesh() {}
 
         TriangleMesh(int vertex_count, int triangle_count, Vector3* vertex_array, int** triangle_array) {
             // Copia os vértices para o container interno
             for (int i = 0; i < vertex_count; i++) {
                 vertices.push_back(vertex_array[i]);
             }
-            // Cria os triângulos utilizando os endereços dos vértices no vetor 'vertices'
+            // Cria os triângulos a partir dos índices no vetor 'vertices'
             for (int i = 0; i < triangle_count; i++) {
                 int* triangle_indices = triangle_array[i];
-                triangles.push_back(Triangle(&vertices[triangle_indices[0]],
-                                               &vertices[triangle_indices[1]],
-                                               &vertices[triangle_indices[2]]));
+                add_triangle(triangle_indices[0], triangle_indices[1], triangle_indices[2], -1);
             }
+            build_bvh();
         }
 
-        #include "MaterialReader.hpp"
-
         // Construtor de TriangleMesh que recebe apenas o caminho do arquivo .obj.
-        TriangleMesh(std::string obj_filepath) {
+        // 'load_threads' é o número de threads usadas na leitura de arquivos grandes (0 = todos os núcleos).
+        TriangleMesh(std::string obj_filepath, int load_threads = 0) {
+            load_obj(obj_filepath, load_threads);
+        }
+
+        // Deriva o caminho do arquivo .mtl a partir do caminho do .obj
+        static std::string mtl_path(const std::string &obj_filepath) {
+            return obj_filepath.substr(0, obj_filepath.find_last_of('.')) + ".mtl";
+        }
+
+        // Lê a malha do .obj (e do .mtl de mesmo nome) e constrói a BVH. Retorna false se o .obj não abrir.
+        bool load_obj(const std::string &obj_filepath, int load_threads = 0) {
+            vertices.clear();
+            indices.clear();
+            face_materials.clear();
+            materials.clear();
+            blocks.clear();
+            node_blocks.clear();
+
             // Deriva o caminho do arquivo .mtl a partir do caminho do .obj
-            std::string mtl_filepath = obj_filepath.substr(0, obj_filepath.find_last_of('.')) + ".mtl";
+            std::string mtl_filepath = mtl_path(obj_filepath);
             
-            // Instancia o MaterialReader com o caminho derivado
+            // Lê o .mtl de mesmo nome; a tabela de materiais da malha fica com a do leitor, sem cópia
             MaterialReader materialReader(mtl_filepath);
             
-            std::ifstream inFile(obj_filepath);
-            if (!inFile.is_open()) {
-                std::cerr << "Erro ao abrir o arquivo: " << obj_filepath << std::endl;
-                return;
+            ObjReader obj(obj_filepath, load_threads);
+            if (!obj.ok) return false;
+
+            // Traduz os nomes usados em "usemtl" para índices na tabela da malha
+            std::vector<int> face_material(obj.material_names.size(), -1);
+            for (size_t m = 0; m < obj.material_names.size(); m++) {
+                face_material[m] = materialReader.find(obj.material_names[m]);
+                if (face_material[m] < 0) std::cerr << "Erro: material '" << obj.material_names[m] << "' não definido no arquivo .mtl." << std::endl;
             }
-            
-            std::string line;
-            // Ponteiro para o material corrente, obtido via MaterialReader
-            Object::Material* current_material = nullptr;
-            
-            // Primeiro, lê os vértices
-            while (std::getline(inFile, line)) {
-                if (line.size() > 2 && line.substr(0, 2) == "v ") {
-                    std::istringstream iss(line.substr(2));
-                    double x, y, z;
-                    if (iss >> x >> y >> z) {
-                        vertices.push_back(Vector3(x, y, z));
-                    }
-                }
+
+            materials.take(materialReader.materials);
+            vertices.take(obj.vertices);
+            indices.reserve(3 * obj.faces.size());
+            face_materials.reserve(obj.faces.size());
+            for (const ObjReader::Face &f : obj.faces) {
+                add_triangle(f.v[0], f.v[1], f.v[2], (f.material >= 0)? face_material[f.material] : -1);
             }
-            
-            // Reinicia o stream para ler faces e diretivas de material
-            inFile.clear();
-            inFile.seekg(0, std::ios::beg);
-            
-            while (std::getline(inFile, line)) {
-                // Processa a diretiva de material
-                if (line.size() > 6 && line.substr(0, 6) == "usemtl") {
-                    std::istringstream iss(line.substr(7)); // pula "usemtl "
-                    std::string materialName;
-                    iss >> materialName;
-                    current_material = materialReader.getMaterial(materialName);
+            build_bvh();
+            return true;
+        }
+
+        size_t triangle_count() const { return face_materials.size(); }
+
+        // Adiciona um triângulo com vértices já presentes em 'vertices'. Ele só é
+        // intersectado depois da próxima build_bvh().
+        void add_triangle(int a, int b, int c, int material) {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+            face_materials.push_back(material);
+        }
+
+        // Constrói a BVH sobre os triângulos e os empacota nos blocos. Deve ser chamada depois
+        // de add_triangle; os índices dos triângulos novos são descartados depois do empacotamento.
+        void build_bvh() {
+            // Os triângulos já empacotados são lidos dos blocos, os novos de 'indices'
+            struct Face { int v[3]; };
+            std::vector<Face> faces(triangle_count());
+            size_t packed = faces.size() - indices.size() / 3;
+            for (size_t n = 0; n < node_blocks.size(); n++) {
+                const BVH::Node &node = bvh.nodes[n];
+                if (!node.is_leaf()) continue;
+                for (int i = 0; i < node.count; i++) {
+                    const Triangle4 &block = blocks[node_blocks[n] + i / 4];
+                    faces[bvh.indices[node.first + i]] = {{block.v[0][i % 4], block.v[1][i % 4], block.v[2][i % 4]}};
                 }
-                // Processa as faces
-                if (line.size() > 2 && line.substr(0, 2) == "f ") {
-                    std::istringstream iss(line.substr(2));
-                    std::string vertexStr;
-                    std::vector<int> faceIndices;
-                    while (iss >> vertexStr) {
-                        std::istringstream tokenStream(vertexStr);
-                        std::string indexStr;
-                        std::getline(tokenStream, indexStr, '/');
-                        try {
-                            int idx = std::stoi(indexStr);
-                            // Converte de 1-indexado (.obj) para 0-indexado
-                            faceIndices.push_back(idx - 1);
-                        } catch (std::invalid_argument&) {
-                            std::cerr << "Formato de face inválido: " << vertexStr << std::endl;
-                        }
-                    }
-                    // Cria os triângulos e atribui o material (por ponteiro)
-                    if (faceIndices.size() == 3) {
-                        Triangle t(&vertices[faceIndices[0]],
-                                &vertices[faceIndices[1]],
-                                &vertices[faceIndices[2]]);
-                        t.material = current_material;  // Atribuição completa do material
-                        triangles.push_back(t);
-                    }
-                    else if (faceIndices.size() > 3) {
-                        // Triangulação em fan para faces com mais de 3 vértices
-                        for (size_t i = 1; i < faceIndices.size() - 1; i++) {
-                            Triangle t(&vertices[faceIndices[0]],
-                                    &vertices[faceIndices[i]],
-                                    &vertices[faceIndices[i + 1]]);
-                            t.material = current_material;
-                            triangles.push_back(t);
-                        }
-                    }
+            }
+            for (size_t i = packed; i < faces.size(); i++) {
+                const int *v = &indices[3 * (i - packed)];
+                faces[i] = {{v[0], v[1], v[2]}};
+            }
+            indices.clear();
+            indices.shrink_to_fit();
+
+            std::vector<BoundingBox> triangle_bounds(faces.size());
+            for (size_t i = 0; i < faces.size(); i++) {
+                for (int k = 0; k < 3; k++) triangle_bounds[i].expand(vertices[faces[i].v[k]]);
+            }
+            bvh.leaf_width = 4;
+            bvh.build(triangle_bounds);
+
+            // Empacota os triângulos de cada folha em blocos SoA para o teste vetorizado
+            blocks.clear();
+            node_blocks.assign(bvh.nodes.size(), -1);
+            for (size_t n = 0; n < bvh.nodes.size(); n++) {
+                const BVH::Node &node = bvh.nodes[n];
+                if (!node.is_leaf()) continue;
+                node_blocks[n] = (int) blocks.size();
+                for (int i = 0; i < node.count; i++) {
+                    if (i % 4 == 0) blocks.push_back(Triangle4());
+                    Triangle4 &block = blocks.back();
+                    int id = bvh.indices[node.first + i];
+                    block.set(block.count++, faces[id].v[0], faces[id].v[1], faces[id].v[2]);
                 }
             }
-            inFile.close();
+        }
+
+        const Object::Material* material_of(int triangle) const {
+            return (face_materials[triangle] >= 0)? &materials[face_materials[triangle]] : material;
+        }
+
+        // Normal da faixa 'lane' do bloco, calculada dos vértices
+        inline Vector3 normal_of(const Triangle4 &block, int lane) const {
+            return block.get_edge1(vertices.data(), lane).cross(block.get_edge2(vertices.data(), lane)).normalized();
+        }
+
+        bool get_bounds(BoundingBox &box) const {
+            if (bvh.nodes.empty()) return false;
+            box = bvh.nodes[0].bounds;
+            return true;
         }
 
         std::string to_string() {
             return "triangle mesh";
         }
 
-        Vector3 get_normal(const Vector3 &p) {
-            std::cerr << "Error: Normal for mesh not implemented\n";
-            return Vector3();
+        Intersection raycast(const Vector3 &p, const Vector3 &v) const {
+            double min_dist = INFINITY, hit_u = 0, hit_v = 0;
+            int hit_index = -1, hit_block = 0, hit_lane = 0;
+            bvh.intersect_leaves(p, v, min_dist, [&](int node, double &t_max) {
+                int first = node_blocks[node], last = first + (bvh.nodes[node].count + 3) / 4;
+                const int *ids = &bvh.indices[bvh.nodes[node].first];
+                for (int b = first; b < last; b++) {
+                    RT_STAT(triangle_tests, blocks[b].count);
+                    alignas(32) double dist[4], u[4], w[4];
+                    int mask = blocks[b].intersect(vertices.data(), p, v, t_max, dist, u, w);
+                    for (int lane = 0; mask; lane++, mask >>= 1) {
+                        if (!(mask & 1)) continue;
+                        int i = ids[4 * (b - first) + lane];
+                        // Em empates (arestas compartilhadas) vence o triângulo que aparece primeiro no arquivo,
+                        // independente da ordem de visita da BVH
+                        if (dist[lane] < t_max || (dist[lane] == t_max && i < hit_index)) {
+                            t_max = dist[lane];
+                            hit_index = i;
+                            hit_block = b;
+                            hit_lane = lane;
+                            hit_u = u[lane];
+                            hit_v = w[lane];
+                        }
+                    }
+                }
+            });
+            if (hit_index < 0) return INFINITY;
+            return Intersection(min_dist, this, normal_of(blocks[hit_block], hit_lane), material_of(hit_index), hit_u, hit_v);
+        }
+
+        // Para no primeiro triângulo atingido no intervalo, sem procurar o mais próximo
+        bool occluded(const Vector3 &p, const Vector3 &v, real t_max) const override {
+            return bvh.any_leaf(p, v, t_max, [&](int node) {
+                int first = node_blocks[node], last = first + (bvh.nodes[node].count + 3) / 4;
+                for (int b = first; b < last; b++) {
+                    RT_STAT(triangle_tests, blocks[b].count);
+                    alignas(32) double dist[4], u[4], w[4];
+                    int mask = blocks[b].intersect(vertices.data(), p, v, t_max, dist, u, w);
+                    for (int lane = 0; mask; lane++, mask >>= 1) {
+                        if ((mask & 1) && dist[lane] > epsilon && dist[lane] < t_max) return true;
+                    }
+                }
+                return false;
+            });
         }
-        Intersection raycast(Vector3 p, Vector3 v) {
-            double min_dist = INFINITY;
-            Object* hit;
-            for (Triangle &t : triangles) {
-                Intersection try_hit = t.raycast(p, v);
-                double dist = try_hit.distance;
-                if (dist < min_dist) {
-                    this->material = t.material;
-                    min_dist = dist;
-                    hit = try_hit.object;
+
+        // Pacote de raios contra a malha: a BVH é percorrida uma vez para os quatro raios
+        // e cada triângulo é testado contra todas as faixas ativas de uma vez
+        void raycast_packet(const RayPacket4 &rays, int mask, Intersection hits[4]) const {
+            alignas(32) double t_max[4] = {INFINITY, INFINITY, INFINITY, INFINITY};
+            alignas(32) double hit_u[4], hit_v[4];
+            int hit_index[4] = {-1, -1, -1, -1}, hit_block[4], hit_slot[4];
+
+            RayPacket4 packet = rays;
+            packet.active = rays.active & mask;
+            Vector3x4 origins = packet.origins(), directions = packet.directions();
+
+            bvh.intersect_packet_leaves(packet, t_max, [&](int node, int lanes) {
+                int first = node_blocks[node], last = first + (bvh.nodes[node].count + 3) / 4;
+                const int *ids = &bvh.indices[bvh.nodes[node].first];
+                const Vector3 *vs = vertices.data();
+                for (int b = first; b < last; b++) {
+                    const Triangle4 &block = blocks[b];
+                    for (int slot = 0; slot < block.count; slot++) {
+                        RT_STAT(triangle_tests, lane_count(lanes));
+                        double4 dist, u, w;
+                        int hit = lanes & intersect_triangles(origins, directions, Vector3x4(block.get_v0(vs, slot)),
+                                                              Vector3x4(block.get_edge1(vs, slot)), Vector3x4(block.get_edge2(vs, slot)),
+                                                              double4::load(t_max), dist, u, w);
+                        if (!hit) continue;
+                        alignas(32) double d[4], uu[4], ww[4];
+                        dist.store(d);
+                        u.store(uu);
+                        w.store(ww);
+                        int i = ids[4 * (b - first) + slot];
+                        for (int lane = 0; lane < 4; lane++) {
+                            if (!(hit & (1 << lane))) continue;
+                            if (d[lane] < t_max[lane] || (d[lane] == t_max[lane] && i < hit_index[lane])) {
+                                t_max[lane] = d[lane];
+                                hit_index[lane] = i;
+                                hit_block[lane] = b;
+                                hit_slot[lane] = slot;
+                                hit_u[lane] = uu[lane];
+                                hit_v[lane] = ww[lane];
+                            }
+                        }
+                    }
+                }
+            });
+
+            for (int lane = 0; lane < 4; lane++) {
+                if (hit_index[lane] < 0) {
+                    hits[lane] = Intersection();
+                    continue;
                 }
+                hits[lane] = Intersection(t_max[lane], this, normal_of(blocks[hit_block[lane]], hit_slot[lane]),
+                                          material_of(hit_index[lane]), hit_u[lane], hit_v[lane]);
             }
-            return Intersection(min_dist, hit);
         }
 };
 
@@ -139,7 +266,7 @@ inline std::ostream& operator<<(std::ostream &os, const TriangleMesh &m) {
     for (Vector3 v : m.vertices) {
         os << "\t\t" << v << "\n";
     }
-    os << "Numero de faces: " << m.triangles.size() << "\n";
+    os << "Numero de faces: " << m.triangle_count() << "\n";
     return os;
 }
 
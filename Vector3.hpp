@@ -7,126 +7,169 @@
 #define Y e[1]
 #define Z e[2]
 
-class Vector3 {
+// Precisão do traçador, escolhida na compilação: double por padrão, float com -DRT_FLOAT
+// (metade da memória nos buffers de vértices; bom para prévias). 'real' vale para o que é
+// guardado (vértices, blocos SIMD, pacotes de raios) e para o sombreamento; os testes
+// vetoriais de SIMD.hpp e a distância máxima (t_max) da travessia da BVH continuam em double.
+#ifdef RT_FLOAT
+typedef float real;
+#else
+typedef double real;
+#endif
+
+// Constantes que dependem da precisão
+template <typename T> struct Precision;
+template <> struct Precision<double> {
+    static constexpr double epsilon = 1.0E-6;
+};
+template <> struct Precision<float> {
+    static constexpr float epsilon = 1.0E-4f;
+};
+
+// Impede que o escalar participe da dedução do tipo: v * 0.5 funciona com float
+template <typename T> struct Scalar { typedef T type; };
+
+template <typename T>
+class BasicVector3 {
 
     public:
-        double e[3];
-        Vector3(): e {0, 0, 0} {}
-        Vector3(double e0, double e1, double e2) {
+        typedef typename Scalar<T>::type K;
+
+        T e[3];
+        BasicVector3(): e {0, 0, 0} {}
+        BasicVector3(K e0, K e1, K e2) {
             X = e0;
             Y = e1;
             Z = e2;
         }
-        inline double x() const {return X; }
-        inline double y() const {return Y; }
-        inline double z() const {return Z; }
-
-        inline const Vector3& operator +() const { return *this; }
-        inline const Vector3 operator -() const { return Vector3(-X, -Y, -Z); }
-
-        inline double operator [](int i) const { return e[i]; }
-        inline double& operator [](int i) { return e[i]; }
-    
-        inline Vector3
-            &operator +=(const Vector3 &other),
-            &operator -=(const Vector3 &other),
-            &operator *=(const double k),
-            &operator /=(const double k);
-    
-        inline double length() const { return sqrt(X*X + Y*Y + Z*Z) ; }
-        inline double sqr_lenght() const { return X*X + Y*Y + Z*Z; }
-        inline Vector3 normalized();
-        inline Vector3 cross(const Vector3 &other);
-        inline const double dot(const Vector3 &other) const;
+        inline T x() const {return X; }
+        inline T y() const {return Y; }
+        inline T z() const {return Z; }
+
+        inline const BasicVector3& operator +() const { return *this; }
+        inline const BasicVector3 operator -() const { return BasicVector3(-X, -Y, -Z); }
+
+        inline T operator [](int i) const { return e[i]; }
+        inline T& operator [](int i) { return e[i]; }
+
+        inline BasicVector3
+            &operator +=(const BasicVector3 &other),
+            &operator -=(const BasicVector3 &other),
+            &operator *=(const K k),
+            &operator /=(const K k);
+
+        inline T length() const { return sqrt(X*X + Y*Y + Z*Z) ; }
+        inline T sqr_lenght() const { return X*X + Y*Y + Z*Z; }
+        inline BasicVector3 normalized() const;
+        inline BasicVector3 cross(const BasicVector3 &other) const;
+        inline const T dot(const BasicVector3 &other) const;
 
 };
 
-inline bool operator ==(Vector3 u, Vector3 v) {
+typedef BasicVector3<real> Vector3;
+
+template <typename T>
+inline bool operator ==(const BasicVector3<T> &u, const BasicVector3<T> &v) {
     return (u.X == v.X) && (u.Y == v.Y) && (u.Z == v.Z);
 }
 
-inline Vector3 Vector3::cross(const Vector3 &other) {
-    return Vector3( this->y() * other.z() - this->z() * other.y(),
-                    this->z() * other.x() - this->x() * other.z(),
-                    this->x() * other.y() - this->y() * other.x() );
+template <typename T>
+inline BasicVector3<T> BasicVector3<T>::cross(const BasicVector3<T> &other) const {
+    return BasicVector3<T>( this->y() * other.z() - this->z() * other.y(),
+                            this->z() * other.x() - this->x() * other.z(),
+                            this->x() * other.y() - this->y() * other.x() );
 }
 
-inline const double Vector3::dot(const Vector3 &other) const{
+template <typename T>
+inline const T BasicVector3<T>::dot(const BasicVector3<T> &other) const{
     return  this->x() * other.x() +
             this->y() * other.y() +
             this->z() * other.z();
 }
 
-inline Vector3 operator +(const Vector3 &u, const Vector3 &v) {
-    return Vector3( u.x() + v.x(),
-                    u.y() + v.y(),
-                    u.z() + v.z() );
+template <typename T>
+inline BasicVector3<T> operator +(const BasicVector3<T> &u, const BasicVector3<T> &v) {
+    return BasicVector3<T>( u.x() + v.x(),
+                            u.y() + v.y(),
+                            u.z() + v.z() );
 }
 
-inline Vector3 operator -(const Vector3 &u, const Vector3 &v) {
-    return Vector3( u.x() - v.x(),
-                    u.y() - v.y(),
-                    u.z() - v.z() );
+template <typename T>
+inline BasicVector3<T> operator -(const BasicVector3<T> &u, const BasicVector3<T> &v) {
+    return BasicVector3<T>( u.x() - v.x(),
+                            u.y() - v.y(),
+                            u.z() - v.z() );
 }
 
-inline Vector3 operator *(const Vector3 &u, const Vector3 &v) {
-    return Vector3( u.x() * v.x(),
-                    u.y() * v.y(),
-                    u.z() * v.z());
+template <typename T>
+inline BasicVector3<T> operator *(const BasicVector3<T> &u, const BasicVector3<T> &v) {
+    return BasicVector3<T>( u.x() * v.x(),
+                            u.y() * v.y(),
+                            u.z() * v.z());
 }
 
-inline Vector3 operator *(const Vector3 &v, const double k) {
-    return Vector3( v.x() * k,
-                    v.y() * k,
-                    v.z() * k );
+template <typename T>
+inline BasicVector3<T> operator *(const BasicVector3<T> &v, const typename Scalar<T>::type k) {
+    return BasicVector3<T>( v.x() * k,
+                            v.y() * k,
+                            v.z() * k );
 }
 
-inline Vector3 operator *(const double k, const Vector3 &v) {return v*k; }
+template <typename T>
+inline BasicVector3<T> operator *(const typename Scalar<T>::type k, const BasicVector3<T> &v) {return v*k; }
 
-inline Vector3 operator /(const Vector3 &v, double k) {
-    return Vector3( v.x() / k,
-                    v.y() / k,
-                    v.z() / k );
+template <typename T>
+inline BasicVector3<T> operator /(const BasicVector3<T> &v, typename Scalar<T>::type k) {
+    return BasicVector3<T>( v.x() / k,
+                            v.y() / k,
+                            v.z() / k );
 }
 
-inline Vector3 Vector3::normalized() {
+template <typename T>
+inline BasicVector3<T> BasicVector3<T>::normalized() const {
     return *this / this->length();
 }
 
-inline Vector3& Vector3::operator+=(const Vector3 &other) {
+template <typename T>
+inline BasicVector3<T>& BasicVector3<T>::operator+=(const BasicVector3<T> &other) {
     X += other.x();
     Y += other.y();
     Z += other.z();
     return *this;
 }
 
-inline Vector3& Vector3::operator-=(const Vector3 &other) {
+template <typename T>
+inline BasicVector3<T>& BasicVector3<T>::operator-=(const BasicVector3<T> &other) {
     X -= other.x();
     Y -= other.y();
     Z -= other.z();
     return *this;
 }
 
-inline Vector3& Vector3::operator*=(const double k) {
-    Z *= k;
+template <typename T>
+inline BasicVector3<T>& BasicVector3<T>::operator*=(const K k) {
+    X *= k;
     Y *= k;
     Z *= k;
     return *this;
 }
 
-inline Vector3& Vector3::operator/=(const double k) {
-    Z /= k;
+template <typename T>
+inline BasicVector3<T>& BasicVector3<T>::operator/=(const K k) {
+    X /= k;
     Y /= k;
     Z /= k;
     return *this;
 }
 
-inline std::istream& operator>>(std::istream &is, Vector3 &v) {
+template <typename T>
+inline std::istream& operator>>(std::istream &is, BasicVector3<T> &v) {
     is >> v.X >> v.Y >> v.Z;
     return is;
 }
 
-inline std::ostream& operator<<(std::ostream &os, const Vector3 &v) {
+template <typename T>
+inline std::ostream& operator<<(std::ostream &os, const BasicVector3<T> &v) {
     os << v.X << " " << v.Y << " " << v.Z;
     return os;
 }
@@ -0,0 +1,536 @@
+// Benchmarks do traçador em dois níveis:
+//  - micro: custo de cada teste de interseção (Sphere, Plane, Triangle, TriangleMesh)
+//    e das operações de Vector3, em ns por teste;
+//  - bvh: construção da BVH de malhas grandes em cada qualidade, com tempo, custo SAH,
+//    profundidade, tamanho das folhas e o custo resultante por raio;
+//  - macro: cenas geradas (muitas esferas, malhas cada vez maiores, instâncias, vidro, muitas luzes,
+//    centenas de luzes com alcance, iluminação refeita sobre o G-buffer)
+//    renderizadas em resolução fixa, com tempo de carga, raios por segundo e pico de memória.
+// O resultado sai em JSON na saída padrão, para comparar versões e pegar regressões.
+//
+// Uso: g++ -O2 benchmark.cpp -o benchmark && ./benchmark [--quick] [--threads N] [filtro]
+// Só rodam os benchmarks cujo nome contém 'filtro'; --quick usa cenas e imagem menores.
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Raytracing.hpp"
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
+using namespace std;
+
+struct Options {
+    bool quick = false;
+    int threads = 0; // 0 = todos os núcleos
+    string filter;
+    int width() const { return quick? 160 : 640; }
+    int height() const { return quick? 90 : 360; }
+};
+
+struct Ray {
+    Vector3 origin, direction;
+};
+
+// Campos de um objeto JSON, na ordem em que foram adicionados
+class Record {
+    public:
+        Record(const string &name) { add("name", "\"" + name + "\""); }
+        Record& add(const string &key, double value) {
+            ostringstream os;
+            os.precision(6);
+            os << value;
+            return add(key, os.str());
+        }
+        Record& add(const string &key, long value) { return add(key, to_string(value)); }
+        Record& add(const string &key, size_t value) { return add(key, to_string(value)); }
+        Record& add(const string &key, const string &json) {
+            fields += (fields.empty()? "" : ", ") + ("\"" + key + "\": ") + json;
+            return *this;
+        }
+        string str() const { return "{" + fields + "}"; }
+    private:
+        string fields;
+};
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Pico de memória residente do processo até agora, em KiB (0 se indisponível)
+static long peak_memory_kb() {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+// Raios partindo de uma caixa em volta da origem e mirando pontos perto dela,
+// para que boa parte atinja os objetos de teste
+static vector<Ray> random_rays(int n, real spread, unsigned seed = 42) {
+    mt19937 rng(seed);
+    uniform_real_distribution<real> from(-5, 5), to(-spread, spread);
+    vector<Ray> rays(n);
+    for (Ray &r : rays) {
+        r.origin = Vector3(from(rng), from(rng), from(rng));
+        r.direction = (Vector3(to(rng), to(rng), to(rng)) - r.origin).normalized();
+    }
+    return rays;
+}
+
+// Esfera UV com 'rings' anéis e 2*rings segmentos (4*rings² triângulos)
+static void tessellated_sphere(int rings, Vector3 center, real radius, vector<Vector3> &vertices, vector<int> &faces) {
+    int segments = 2 * rings;
+    for (int i = 0; i <= rings; i++) {
+        real theta = M_PI * i / rings;
+        for (int j = 0; j < segments; j++) {
+            real phi = 2 * M_PI * j / segments;
+            vertices.push_back(center + Vector3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)) * radius);
+        }
+    }
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) {
+            int a = i * segments + j, b = i * segments + (j + 1) % segments;
+            int c = a + segments, d = b + segments;
+            faces.insert(faces.end(), {a, b, d, a, d, c});
+        }
+    }
+}
+
+static void build_mesh(TriangleMesh &mesh, int rings, Vector3 center, real radius) {
+    vector<Vector3> vertices;
+    vector<int> faces;
+    tessellated_sphere(rings, center, radius, vertices, faces);
+    for (const Vector3 &v : vertices) mesh.vertices.push_back(v);
+    for (size_t f = 0; f < faces.size(); f += 3) mesh.add_triangle(faces[f], faces[f + 1], faces[f + 2], -1);
+    mesh.build_bvh();
+}
+
+// Grava a esfera tesselada como .obj (com um .mtl ao lado) para medir a carga do arquivo
+static string write_obj(int rings, Vector3 center, real radius) {
+    vector<Vector3> vertices;
+    vector<int> faces;
+    tessellated_sphere(rings, center, radius, vertices, faces);
+    string base = (filesystem::temp_directory_path() / ("rt_benchmark_" + to_string(rings))).string();
+    ofstream mtl(base + ".mtl");
+    mtl << "newmtl cinza\nKd 0.7 0.7 0.7\nKs 0.2 0.2 0.2\nNs 50\n";
+    ofstream obj(base + ".obj");
+    obj << "mtllib " << filesystem::path(base + ".mtl").filename().string() << "\nusemtl cinza\n";
+    for (const Vector3 &v : vertices) obj << "v " << v << "\n";
+    for (size_t f = 0; f < faces.size(); f += 3) obj << "f " << faces[f] + 1 << " " << faces[f + 1] + 1 << " " << faces[f + 2] + 1 << "\n";
+    return base;
+}
+
+class Benchmark {
+    public:
+        Benchmark(const Options &options): options {options} {}
+
+        bool selected(const string &name) const {
+            return options.filter.empty() || name.find(options.filter) != string::npos;
+        }
+
+        // Repete 'test' sobre todos os raios até somar pelo menos 'min_seconds'
+        template <typename Test>
+        void micro(const string &name, const vector<Ray> &rays, Test &&test) {
+            if (!selected(name)) return;
+            const double min_seconds = options.quick? 0.05 : 0.5;
+            long tests = 0, hits = 0;
+            auto start = chrono::steady_clock::now();
+            double elapsed = 0;
+            do {
+                for (const Ray &r : rays) hits += test(r);
+                tests += rays.size();
+                elapsed = seconds_since(start);
+            } while (elapsed < min_seconds);
+            micro_results.push_back(Record(name)
+                .add("tests", tests)
+                .add("ns_per_test", elapsed * 1e9 / tests)
+                .add("tests_per_second", tests / elapsed)
+                .add("hit_rate", (double) hits / tests).str());
+        }
+
+        // Constrói a BVH de 'mesh' (já com os triângulos) e mede o custo por raio da árvore resultante
+        void bvh(const string &name, TriangleMesh &mesh, const vector<Ray> &rays) {
+            if (!selected(name)) return;
+            mesh.bvh.build_threads = options.threads;
+            mesh.build_bvh();
+            const BVH::BuildStats &stats = mesh.bvh.build_stats;
+
+            long hits = 0;
+            auto start = chrono::steady_clock::now();
+            for (const Ray &r : rays) hits += mesh.raycast(r.origin, r.direction).distance != INFINITY;
+            double elapsed = seconds_since(start);
+
+            bvh_results.push_back(Record(name)
+                .add("triangles", mesh.triangle_count())
+                .add("build_seconds", stats.seconds)
+                .add("sah_cost", stats.sah_cost)
+                .add("depth", (long) stats.depth)
+                .add("leaves", (long) stats.leaves)
+                .add("smallest_leaf", (long) stats.smallest_leaf)
+                .add("largest_leaf", (long) stats.largest_leaf)
+                .add("average_leaf", stats.average_leaf)
+                .add("ns_per_ray", elapsed * 1e9 / rays.size())
+                .add("hit_rate", (double) hits / rays.size()).str());
+        }
+
+        // Renderiza a cena uma vez; 'load_seconds' e 'build_seconds' vêm de quem montou a cena
+        void macro(const string &name, const Scene &scene, Camera &camera, double load_seconds, double build_seconds) {
+            camera.screen_width = options.width();
+            camera.screen_height = options.height();
+            camera.threads = options.threads;
+            Framebuffer image(camera.screen_width, camera.screen_height);
+
+            auto start = chrono::steady_clock::now();
+            camera.render(scene, image);
+            double render_seconds = seconds_since(start);
+
+            // Os raios de todos os tipos são contados num segundo quadro, igual ao primeiro,
+            // para que a contagem não pese no tempo medido
+            bool counting = camera.collect_stats;
+            camera.collect_stats = true;
+            camera.render(scene, image);
+            camera.collect_stats = counting;
+            const RenderStats &stats = camera.stats;
+
+            long primary_rays = (long) camera.screen_width * camera.screen_height;
+            Record record(name);
+            record.add("objects", scene.objects.size())
+                .add("scene_arena_kb", scene.arena_bytes() / 1024)
+                .add("lights", camera.lights.size())
+                .add("load_seconds", load_seconds)
+                .add("build_seconds", build_seconds)
+                .add("render_seconds", render_seconds)
+                .add("primary_rays", primary_rays)
+                .add("primary_rays_per_second", primary_rays / render_seconds);
+            if (RenderStats::compiled_in) {
+                record.add("shadow_rays", (long) stats.shadow_rays)
+                    .add("secondary_rays", (long) (stats.reflection_rays + stats.refraction_rays))
+                    .add("rays", (long) stats.rays())
+                    .add("rays_per_second", stats.rays() / render_seconds);
+            }
+            macro_results.push_back(record.add("peak_memory_kb", peak_memory_kb()).str());
+        }
+
+        // Quadro completo com o G-buffer ligado, depois um relight() após mudar as luzes e
+        // outro após mudar 'material'
+        void relight(const string &name, const Scene &scene, Camera &camera, Object::Material &material) {
+            camera.screen_width = options.width();
+            camera.screen_height = options.height();
+            camera.threads = options.threads;
+            camera.cache_primary_hits = true;
+            Framebuffer image(camera.screen_width, camera.screen_height);
+
+            auto start = chrono::steady_clock::now();
+            camera.render(scene, image);
+            double render_seconds = seconds_since(start);
+
+            for (Camera::Light &light : camera.lights) light.color = light.color * (real) 0.8;
+            camera.ambient_light = Color(0.2, 0.2, 0.3);
+            start = chrono::steady_clock::now();
+            camera.relight(scene, image);
+            double light_seconds = seconds_since(start);
+
+            material.diffuse = Color(0.8, 0.2, 0.2);
+            start = chrono::steady_clock::now();
+            camera.relight(scene, image, &material);
+            double material_seconds = seconds_since(start);
+
+            macro_results.push_back(Record(name)
+                .add("objects", scene.objects.size())
+                .add("lights", camera.lights.size())
+                .add("render_seconds", render_seconds)
+                .add("relight_lights_seconds", light_seconds)
+                .add("relight_material_seconds", material_seconds)
+                .add("gbuffer_kb", (long) (camera.gbuffer.hits.size() * sizeof(Object::Intersection) / 1024)).str());
+        }
+
+        void print(ostream &os) const {
+            os << "{\n"
+               << "  \"precision\": \"" << (sizeof(real) == sizeof(float)? "float" : "double") << "\",\n"
+               << "  \"simd\": \"" << simd_isa() << "\",\n"
+               << "  \"threads\": " << (options.threads > 0? options.threads : ThreadPool::default_thread_count()) << ",\n"
+               << "  \"resolution\": [" << options.width() << ", " << options.height() << "],\n";
+            print_list(os, "micro", micro_results);
+            os << ",\n";
+            print_list(os, "bvh", bvh_results);
+            os << ",\n";
+            print_list(os, "macro", macro_results);
+            os << ",\n  \"peak_memory_kb\": " << peak_memory_kb() << "\n}\n";
+        }
+
+    private:
+        const Options &options;
+        vector<string> micro_results;
+        vector<string> bvh_results;
+        vector<string> macro_results;
+
+        static void print_list(ostream &os, const string &key, const vector<string> &items) {
+            os << "  \"" << key << "\": [";
+            for (size_t i = 0; i < items.size(); i++) os << (i? ",\n    " : "\n    ") << items[i];
+            os << (items.empty()? "]" : "\n  ]");
+        }
+};
+
+static void micro_benchmarks(Benchmark &bench, const Options &options) {
+    vector<Ray> rays = random_rays(options.quick? 10000 : 100000, 1.5);
+
+    Sphere sphere(Vector3(0, 0, 0), 1);
+    bench.micro("sphere_raycast", rays, [&](const Ray &r) { return sphere.raycast(r.origin, r.direction).distance != INFINITY; });
+    bench.micro("sphere_occluded", rays, [&](const Ray &r) { return sphere.occluded(r.origin, r.direction, INFINITY); });
+
+    Plane plane(Vector3(0, 0, 0), Vector3(0, 1, 0));
+    bench.micro("plane_raycast", rays, [&](const Ray &r) { return plane.raycast(r.origin, r.direction).distance != INFINITY; });
+
+    Vector3 a(-1, -1, 0), b(1, -1, 0), c(0, 1, 0);
+    Triangle triangle(a, b, c);
+    bench.micro("triangle_raycast", rays, [&](const Ray &r) { return triangle.raycast(r.origin, r.direction).distance != INFINITY; });
+
+    vector<int> mesh_rings = options.quick? vector<int> {8, 64} : vector<int> {8, 64, 256};
+    for (int rings : mesh_rings) {
+        string name = "mesh_raycast_" + to_string(4 * rings * rings);
+        string occluded_name = "mesh_occluded_" + to_string(4 * rings * rings);
+        if (!bench.selected(name) && !bench.selected(occluded_name)) continue;
+        TriangleMesh mesh;
+        build_mesh(mesh, rings, Vector3(0, 0, 0), 1);
+        bench.micro(name, rays, [&](const Ray &r) { return mesh.raycast(r.origin, r.direction).distance != INFINITY; });
+        bench.micro(occluded_name, rays, [&](const Ray &r) { return mesh.occluded(r.origin, r.direction, INFINITY); });
+    }
+
+    // Operações de Vector3: o resultado é acumulado para que o compilador não descarte o laço
+    Vector3 sum;
+    bench.micro("vector3_dot", rays, [&](const Ray &r) { return r.origin.dot(r.direction) > 0; });
+    bench.micro("vector3_cross", rays, [&](const Ray &r) { sum += r.origin.cross(r.direction); return sum.x() > 0; });
+    bench.micro("vector3_normalized", rays, [&](const Ray &r) { sum += r.origin.normalized(); return sum.y() > 0; });
+    bench.micro("vector3_add_scale", rays, [&](const Ray &r) { sum += r.origin * 0.5 + r.direction; return sum.z() > 0; });
+}
+
+static Camera default_camera() {
+    Camera camera(Vector3(-2, 3, 0), Vector3(6, 1.5, 0));
+    camera.lights.emplace_back(Vector3(0, 8, -5));
+    camera.ambient_light = Color(0.1, 0.1, 0.4);
+    return camera;
+}
+
+// Esferas aleatórias sobre um plano, na região vista pela câmera padrão
+static void random_spheres(int n, Scene &scene, Object::Material *material, unsigned seed = 7) {
+    mt19937 rng(seed);
+    uniform_real_distribution<real> x(3, 14), z(-6, 6), radius(0.05, 0.4);
+    for (int i = 0; i < n; i++) {
+        real r = radius(rng);
+        Sphere *s = scene.create<Sphere>(Vector3(x(rng), r, z(rng)), r);
+        s->material = material;
+    }
+}
+
+// Constrói a cena, cujos objetos já foram criados na sua arena, e mede o tempo
+static void build_scene(Scene &scene, double &build_seconds) {
+    auto start = chrono::steady_clock::now();
+    scene.build();
+    build_seconds = seconds_since(start);
+}
+
+static void bvh_benchmarks(Benchmark &bench, const Options &options) {
+    vector<Ray> rays = random_rays(options.quick? 10000 : 100000, 1.5);
+    const char *names[] = {"fast", "binned", "full"};
+    vector<int> mesh_rings = options.quick? vector<int> {64} : vector<int> {64, 256, 512};
+    for (int rings : mesh_rings) {
+        TriangleMesh mesh;
+        build_mesh(mesh, rings, Vector3(0, 0, 0), 1);
+        for (int q = BVH::FAST; q <= BVH::FULL; q++) {
+            mesh.bvh.quality = (BVH::Quality) q;
+            bench.bvh(string("bvh_") + names[q] + "_" + to_string(mesh.triangle_count()), mesh, rays);
+        }
+    }
+}
+
+static void macro_benchmarks(Benchmark &bench, const Options &options) {
+    Object::Material floor, matte, glass;
+    floor.diffuse = Color(0.6, 0.3, 0);
+    floor.ambient = Color(0.1, 0.05, 0);
+    matte.diffuse = Color(0.2, 0.5, 0.8);
+    matte.specular = Color(0.2, 0.2, 0.2);
+    matte.ns = 50;
+    glass.diffuse = Color(0.05, 0.05, 0.05);
+    glass.specular = Color(0.5, 0.5, 0.5);
+    glass.ns = 100;
+    glass.opacity = 0.3;
+    glass.ni = 1.5;
+
+    auto floor_plane = [&](Scene &scene) {
+        scene.create<Plane>(Vector3(0, 0, 0), Vector3(0, 1, 0))->material = &floor;
+    };
+
+    vector<int> sphere_counts = options.quick? vector<int> {10, 100} : vector<int> {10, 100, 1000, 10000};
+    for (int n : sphere_counts) {
+        string name = "spheres_" + to_string(n);
+        if (!bench.selected(name)) continue;
+        Scene scene;
+        floor_plane(scene);
+        random_spheres(n, scene, &matte);
+        double build_seconds;
+        build_scene(scene, build_seconds);
+        Camera camera = default_camera();
+        bench.macro(name, scene, camera, 0, build_seconds);
+    }
+
+    vector<int> mesh_rings = options.quick? vector<int> {16, 64} : vector<int> {16, 64, 256, 512};
+    for (int rings : mesh_rings) {
+        string name = "mesh_" + to_string(4 * rings * rings);
+        if (!bench.selected(name)) continue;
+        string base = write_obj(rings, Vector3(6, 1.5, 0), 1.2);
+        Scene scene;
+        floor_plane(scene);
+        auto start = chrono::steady_clock::now();
+        bool loaded = scene.create<TriangleMesh>()->load_obj(base + ".obj");
+        double load_seconds = seconds_since(start);
+        filesystem::remove(base + ".obj");
+        filesystem::remove(base + ".mtl");
+        if (!loaded) continue;
+        double build_seconds;
+        build_scene(scene, build_seconds);
+        Camera camera = default_camera();
+        bench.macro(name, scene, camera, load_seconds, build_seconds);
+        // A mesma malha com os pixels de cada bloco percorridos por linhas, para comparar com a ordem de Morton
+        if (bench.selected(name + "_scanline")) {
+            camera.morton_order = false;
+            bench.macro(name + "_scanline", scene, camera, load_seconds, build_seconds);
+            camera.morton_order = true;
+        }
+        if (bench.selected(name + "_wavefront")) {
+            camera.wavefront = true;
+            bench.macro(name + "_wavefront", scene, camera, load_seconds, build_seconds);
+        }
+    }
+
+    // Muitas cópias da mesma malha: a geometria existe uma vez, só as instâncias se repetem
+    vector<int> instance_counts = options.quick? vector<int> {100} : vector<int> {100, 10000};
+    for (int n : instance_counts) {
+        string name = "instances_" + to_string(n);
+        if (!bench.selected(name)) continue;
+        auto start = chrono::steady_clock::now();
+        // A malha original fica fora da cena; só as instâncias são renderizadas
+        TriangleMesh mesh;
+        build_mesh(mesh, 64, Vector3(0, 0, 0), 1);
+        mesh.material = &matte;
+        double load_seconds = seconds_since(start);
+
+        Scene scene;
+        floor_plane(scene);
+        mt19937 rng(11);
+        uniform_real_distribution<real> x(3, 14), z(-6, 6), size(0.05, 0.4), angle(0, 2 * M_PI);
+        for (int i = 0; i < n; i++) {
+            Instance *instance = scene.create<Instance>(&mesh);
+            real s = size(rng);
+            instance->scale(Vector3(s, s * 1.5, s));
+            instance->rotate(0, angle(rng), 0);
+            instance->translate(x(rng), s * 1.5, z(rng));
+        }
+        double build_seconds;
+        build_scene(scene, build_seconds);
+        Camera camera = default_camera();
+        bench.macro(name, scene, camera, load_seconds, build_seconds);
+    }
+
+    if (bench.selected("glass") || bench.selected("glass_wavefront")) {
+        Scene scene;
+        floor_plane(scene);
+        for (int i = 0; i < 5; i++) {
+            for (int k = 0; k < 5; k++) {
+                scene.create<Sphere>(Vector3(6 + i * 1.5, 1, -3 + k * 1.5), 0.7)->material = &glass;
+            }
+        }
+        double build_seconds;
+        build_scene(scene, build_seconds);
+        Camera camera = default_camera();
+        if (bench.selected("glass")) bench.macro("glass", scene, camera, 0, build_seconds);
+        // Os mesmos caminhos de reflexão e refração traçados em frentes de onda
+        camera.wavefront = true;
+        bench.macro("glass_wavefront", scene, camera, 0, build_seconds);
+    }
+
+    // Iluminação refeita sobre o G-buffer: malha grande, esferas foscas e uma de vidro
+    if (bench.selected("relight")) {
+        Object::Material relit = matte;
+        Scene scene;
+        floor_plane(scene);
+        random_spheres(100, scene, &relit);
+        TriangleMesh *mesh = scene.create<TriangleMesh>();
+        build_mesh(*mesh, options.quick? 64 : 256, Vector3(6, 1.5, 0), 1.2);
+        mesh->material = &matte;
+        scene.create<Sphere>(Vector3(4, 1, 2.5), 0.8)->material = &glass;
+        double build_seconds;
+        build_scene(scene, build_seconds);
+        Camera camera = default_camera();
+        bench.relight("relight", scene, camera, relit);
+    }
+
+    vector<int> light_counts = options.quick? vector<int> {1, 16} : vector<int> {1, 16, 64};
+    for (int n : light_counts) {
+        string name = "lights_" + to_string(n);
+        if (!bench.selected(name)) continue;
+        Scene scene;
+        floor_plane(scene);
+        random_spheres(100, scene, &matte);
+        double build_seconds;
+        build_scene(scene, build_seconds);
+        Camera camera = default_camera();
+        camera.lights.clear();
+        mt19937 rng(3);
+        uniform_real_distribution<real> x(0, 14), y(4, 10), z(-8, 8);
+        for (int i = 0; i < n; i++) {
+            camera.lights.emplace_back(Vector3(x(rng), y(rng), z(rng)));
+            camera.lights.back().color = Color(1, 1, 1) * (real) (1.0 / n);
+        }
+        bench.macro(name, scene, camera, 0, build_seconds);
+    }
+
+    // Centenas de luzes pequenas com alcance limitado: todas as que alcançam cada ponto
+    // ("_all") ou só 4 sorteadas por ponto ("_sampled")
+    vector<int> many_counts = options.quick? vector<int> {256} : vector<int> {256, 1024};
+    for (int n : many_counts) {
+        for (int samples : {0, 4}) {
+            string name = "many_lights_" + to_string(n) + (samples? "_sampled" : "_all");
+            if (!bench.selected(name)) continue;
+            Scene scene;
+            floor_plane(scene);
+            random_spheres(100, scene, &matte);
+            double build_seconds;
+            build_scene(scene, build_seconds);
+            Camera camera = default_camera();
+            camera.lights.clear();
+            camera.light_samples = samples;
+            mt19937 rng(3);
+            uniform_real_distribution<real> x(0, 14), y(0.5, 3), z(-8, 8);
+            for (int i = 0; i < n; i++) {
+                camera.lights.emplace_back(Vector3(x(rng), y(rng), z(rng)));
+                camera.lights.back().range = 3;
+                camera.lights.back().color = Color(1, 1, 1) * (real) (32.0 / n);
+            }
+            bench.macro(name, scene, camera, 0, build_seconds);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--quick") options.quick = true;
+        else if (arg == "--threads" && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else options.filter = arg;
+    }
+
+    Benchmark bench(options);
+    micro_benchmarks(bench, options);
+    bvh_benchmarks(bench, options);
+    macro_benchmarks(bench, options);
+    bench.print(cout);
+    return 0;
+}
@@ -38,6 +38,7 @@ int main() {
     cam.lights[0].color = Color(1, 1, 1);
     //cam.lights[1].color = Color(0.3, 0.3, 0.3);
     cam.ambient_light = Color(0.1, 0.1, 0.4);
+    cam.threads = 0; // renderiza em paralelo com todos os núcleos
 
     //cam.light_sources.emplace_back(0, 5, 0);
     TriangleMesh mesh("inputs/icosahedron.obj");
@@ -46,7 +47,7 @@ int main() {
     // Vector3 b(1, 2, 2);
     // Vector3 c(-1, 2, 2);
 
-    // Triangle tri = Triangle(&a, &b, &c);
+    // Triangle tri = Triangle(a, b, c);
     // tri.material = &branco;
 
     objs.push_back(&plano);
@@ -0,0 +1,44 @@
+// Gera o cache binário (.rtcache) de malhas .obj, para que o renderizador
+// carregue a malha já processada (com a BVH pronta) sem ler o texto.
+//
+// Uso: g++ -O2 mesh_cache.cpp -o mesh_cache && ./mesh_cache [arquivo.obj ...]
+// Sem argumentos, processa todos os .obj de inputs/.
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include "Raytracing.hpp"
+#include "MeshCache.hpp"
+using namespace std;
+
+int main(int argc, char **argv) {
+    vector<string> files;
+    for (int i = 1; i < argc; i++) files.push_back(argv[i]);
+    if (files.empty()) {
+        for (auto &entry : filesystem::directory_iterator("inputs")) {
+            if (entry.path().extension() == ".obj") files.push_back(entry.path().string());
+        }
+    }
+
+    int failures = 0;
+    for (const string &obj : files) {
+        auto start = chrono::steady_clock::now();
+        TriangleMesh mesh;
+        if (!mesh.load_obj(obj)) {
+            failures++;
+            continue;
+        }
+        string cache = MeshCache::default_path(obj);
+        if (!MeshCache::save(mesh, cache, obj)) {
+            cerr << "Erro ao gravar " << cache << endl;
+            failures++;
+            continue;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << cache << ": " << mesh.triangle_count() << " triângulos, "
+             << mesh.bvh.nodes.size() << " nós da BVH (" << seconds << " s)" << endl;
+        cout << "  ";
+        mesh.bvh.build_stats.print(cout);
+        cout << endl;
+    }
+    return failures == 0? 0 : 1;
+}
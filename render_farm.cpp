@@ -0,0 +1,362 @@
+// Renderização distribuída: um coordenador divide a imagem em blocos e os entrega a
+// processos de trabalho conectados por socket (UNIX local ou TCP "host:porta").
+// Cada trabalhador pede o próximo bloco assim que entrega o anterior, então os lentos
+// recebem menos blocos; um bloco cujo trabalhador cai ou estoura o tempo volta para a
+// fila e é refeito por outro. O coordenador monta a imagem e a grava em faixas à
+// medida que elas ficam completas. A semente de cada pixel não depende de quem o
+// renderizou, então a imagem é idêntica à de um processo só.
+//
+// Uso: g++ -O2 -pthread render_farm.cpp -o render_farm
+//      ./render_farm coordinator <endereço> <saída.ppm|.pfm|-> [opções] [malha.obj ...]
+//      ./render_farm worker <endereço> [--crash-after N]
+// opções do coordenador:
+//   --spawn N       inicia N trabalhadores locais (para testar numa máquina só)
+//   --width W --height H --tile S --depth D
+//   --camera px py pz tx ty tz
+//   --timeout s     tempo máximo de um bloco antes de ser refeito (padrão 60)
+//   --attempts n    tentativas por bloco antes de desistir (padrão 3)
+//   --crash-after N o primeiro trabalhador de --spawn cai depois de N blocos (teste)
+// A cena é a de main.cpp (chão e as malhas dadas, ou inputs/icosahedron.obj); os
+// caminhos das malhas vão para os trabalhadores, que os carregam pelo MeshCache.
+//
+// Protocolo (linhas de texto): o coordenador envia "job <largura> <altura> <px> <py> <pz>
+// <alvo_x> <alvo_y> <alvo_z> <profundidade> <bloco> <malhas...>", depois "tile <tx> <ty>"
+// por bloco, e "done" no fim. O trabalhador responde cada bloco com "pixels <tx> <ty>
+// <bytes>" seguido das cores do bloco em radiância linear (real x 3, linha a linha).
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include "Raytracing.hpp"
+#include "Socket.hpp"
+using namespace std;
+
+struct Job {
+    int width = 1600, height = 900;
+    Vector3 position = Vector3(-2, 3, 0), target = Vector3(6, 1.5, 0);
+    int depth = 5;
+    int tile = 64;
+    vector<string> meshes;
+
+    string to_line() const {
+        ostringstream out;
+        out.precision(17);
+        out << "job " << width << " " << height << " " << position << " " << target << " " << depth << " " << tile;
+        for (const string &m : meshes) out << " " << m;
+        return out.str();
+    }
+
+    bool parse(const string &line) {
+        istringstream in(line);
+        string command;
+        if (!(in >> command >> width >> height >> position >> target >> depth >> tile) || command != "job") return false;
+        meshes.clear();
+        string m;
+        while (in >> m) meshes.push_back(m);
+        return width > 0 && height > 0 && tile > 0;
+    }
+
+    int tiles_x() const { return (width + tile - 1) / tile; }
+    int tiles_y() const { return (height + tile - 1) / tile; }
+};
+
+// Cena de main.cpp: chão e as malhas do trabalho, todos na arena da cena
+struct DemoScene {
+    Scene scene;
+
+    bool load(const vector<string> &files) {
+        Object::Material *floor = scene.create_material();
+        floor->diffuse = Color(0.6, 0.3, 0);
+        floor->ambient = Color(0.1, 0.05, 0);
+        scene.create<Plane>(Vector3(0, 0, 0), Vector3(0, 1, 0))->material = floor;
+        for (const string &file : files) {
+            if (!MeshCache::open(*scene.create<TriangleMesh>(), file, "", 1)) {
+                cerr << "Erro ao carregar " << file << endl;
+                return false;
+            }
+        }
+        scene.build();
+        return true;
+    }
+};
+
+static int worker(const string &address, int crash_after) {
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && fd < 0; attempt++) {
+        fd = Socket::connect_to(address);
+        if (fd < 0) this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    if (fd < 0) {
+        cerr << "Erro ao conectar em " << address << endl;
+        return 1;
+    }
+    string line;
+    Job job;
+    if (!Socket::recv_line(fd, line) || !job.parse(line)) {
+        cerr << "Trabalho inválido: " << line << endl;
+        return 1;
+    }
+    DemoScene demo;
+    if (!demo.load(job.meshes)) return 1;
+
+    Camera camera(job.position, job.target);
+    camera.screen_width = job.width;
+    camera.screen_height = job.height;
+    camera.tile_size = job.tile;
+    camera.max_depth = job.depth;
+    camera.lights.emplace_back(Vector3(0, 8, -5));
+    camera.ambient_light = Color(0.1, 0.1, 0.4);
+    camera.begin_frame();
+    Framebuffer image(job.width, job.height);
+
+    vector<Color> pixels;
+    int done = 0;
+    while (Socket::recv_line(fd, line) && line != "done") {
+        istringstream in(line);
+        string command;
+        int tx, ty;
+        if (!(in >> command >> tx >> ty) || command != "tile" || tx < 0 || ty < 0 || tx >= job.tiles_x() || ty >= job.tiles_y()) {
+            cerr << "Pedido inválido: " << line << endl;
+            return 1;
+        }
+        if (crash_after >= 0 && done == crash_after) _exit(3);
+        camera.draw_tile(demo.scene, image, tx, ty);
+
+        int row_end = min(job.height, (ty + 1) * job.tile), col_end = min(job.width, (tx + 1) * job.tile);
+        pixels.clear();
+        for (int r = ty * job.tile; r < row_end; r++)
+            pixels.insert(pixels.end(), &image.at(r, tx * job.tile), &image.at(r, 0) + col_end);
+        size_t bytes = pixels.size() * sizeof(Color);
+        if (!Socket::send_line(fd, "pixels " + to_string(tx) + " " + to_string(ty) + " " + to_string(bytes))
+            || !Socket::send_all(fd, pixels.data(), bytes)) return 1;
+        done++;
+    }
+    ::close(fd);
+    return 0;
+}
+
+class Coordinator {
+    public:
+        double timeout = 60;
+        int max_attempts = 3;
+
+        Coordinator(const Job &job, Framebuffer &image, ImageWriter &writer):
+            job {job}, image {image}, writer {writer},
+            attempts(job.tiles_x() * job.tiles_y(), 0), band_remaining(job.tiles_y(), job.tiles_x())
+        {
+            for (int t = 0; t < job.tiles_x() * job.tiles_y(); t++) pending.push_back(t);
+            remaining = (int) pending.size();
+        }
+
+        // Aceita trabalhadores em 'listener' até a imagem ficar pronta. 'children' são os
+        // processos iniciados por --spawn: se todos saírem com blocos faltando, desiste.
+        bool run(int listener, vector<pid_t> children) {
+            thread acceptor([this, listener] {
+                while (true) {
+                    int fd = ::accept(listener, nullptr, nullptr);
+                    if (fd < 0) {
+                        if (errno == EINTR) continue;
+                        return;
+                    }
+                    lock_guard<mutex> lock(m);
+                    active++;
+                    handlers.emplace_back(&Coordinator::handle, this, fd, (int) handlers.size());
+                }
+            });
+
+            {
+                unique_lock<mutex> lock(m);
+                while (remaining > 0 && !failed) {
+                    changed.wait_for(lock, chrono::milliseconds(200));
+                    for (size_t i = 0; i < children.size(); i++) {
+                        if (waitpid(children[i], nullptr, WNOHANG) == children[i]) children.erase(children.begin() + i--);
+                    }
+                    if (!children.empty() || active > 0 || remaining == 0) continue;
+                    if (spawned) {
+                        cerr << "Todos os trabalhadores saíram com " << remaining << " blocos faltando" << endl;
+                        failed = true;
+                    }
+                }
+                changed.notify_all();
+            }
+            ::shutdown(listener, SHUT_RDWR);
+            acceptor.join();
+            for (thread &t : handlers) t.join();
+            for (pid_t child : children) waitpid(child, nullptr, 0);
+
+            for (size_t i = 0; i < worker_tiles.size(); i++) {
+                clog << "trabalhador " << i << ": " << worker_tiles[i] << " blocos" << endl;
+            }
+            clog << retries << " blocos refeitos" << endl;
+            return !failed;
+        }
+
+        bool spawned = false;
+
+    private:
+        const Job &job;
+        Framebuffer &image;
+        ImageWriter &writer;
+
+        mutex m;
+        condition_variable changed;
+        deque<int> pending;
+        vector<int> attempts;
+        vector<int> band_remaining;
+        vector<int> worker_tiles;
+        vector<thread> handlers;
+        int remaining;
+        int active = 0;
+        int retries = 0;
+        bool failed = false;
+
+        void handle(int fd, int id) {
+            Socket::set_timeout(fd, timeout);
+            Socket::set_no_delay(fd);
+            bool alive = Socket::send_line(fd, job.to_line());
+            vector<Color> pixels;
+            while (alive) {
+                int t;
+                {
+                    unique_lock<mutex> lock(m);
+                    changed.wait(lock, [this] { return !pending.empty() || remaining == 0 || failed; });
+                    if (remaining == 0 || failed) break;
+                    t = pending.front();
+                    pending.pop_front();
+                }
+                int tx = t % job.tiles_x(), ty = t / job.tiles_x();
+                if (!(alive = fetch(fd, tx, ty, pixels))) {
+                    lock_guard<mutex> lock(m);
+                    if (++attempts[t] >= max_attempts) {
+                        cerr << "Bloco (" << tx << ", " << ty << ") falhou " << attempts[t] << " vezes" << endl;
+                        failed = true;
+                    } else {
+                        pending.push_front(t);
+                        retries++;
+                    }
+                    break;
+                }
+
+                int row_end = min(job.height, (ty + 1) * job.tile), col_end = min(job.width, (tx + 1) * job.tile);
+                const Color *p = pixels.data();
+                for (int r = ty * job.tile; r < row_end; r++, p += col_end - tx * job.tile)
+                    copy(p, p + col_end - tx * job.tile, &image.at(r, tx * job.tile));
+
+                bool band_done;
+                {
+                    lock_guard<mutex> lock(m);
+                    if ((int) worker_tiles.size() <= id) worker_tiles.resize(id + 1, 0);
+                    worker_tiles[id]++;
+                    band_done = --band_remaining[ty] == 0;
+                    remaining--;
+                }
+                if (band_done) writer.rows_ready(ty * job.tile, row_end - ty * job.tile);
+                changed.notify_all();
+            }
+            if (alive) Socket::send_line(fd, "done");
+            ::close(fd);
+            lock_guard<mutex> lock(m);
+            active--;
+            changed.notify_all();
+        }
+
+        // Pede o bloco (tx, ty) e recebe suas cores; false se o trabalhador falhou
+        bool fetch(int fd, int tx, int ty, vector<Color> &pixels) {
+            int rows = min(job.height, (ty + 1) * job.tile) - ty * job.tile;
+            int cols = min(job.width, (tx + 1) * job.tile) - tx * job.tile;
+            pixels.resize((size_t) rows * cols);
+            string reply, command;
+            int rx, ry;
+            size_t bytes;
+            if (!Socket::send_line(fd, "tile " + to_string(tx) + " " + to_string(ty)) || !Socket::recv_line(fd, reply)) return false;
+            istringstream in(reply);
+            if (!(in >> command >> rx >> ry >> bytes) || command != "pixels" || rx != tx || ry != ty) return false;
+            if (bytes != pixels.size() * sizeof(Color)) return false;
+            return Socket::recv_all(fd, pixels.data(), bytes);
+        }
+};
+
+static int coordinator(int argc, char **argv) {
+    string address = argv[2], output = argv[3];
+    Job job;
+    int spawn = 0, crash_after = -1, max_attempts = 3;
+    double timeout = 60;
+    for (int i = 4; i < argc; i++) {
+        string arg = argv[i];
+        bool more = i + 1 < argc;
+        if (arg == "--spawn" && more) spawn = atoi(argv[++i]);
+        else if (arg == "--width" && more) job.width = atoi(argv[++i]);
+        else if (arg == "--height" && more) job.height = atoi(argv[++i]);
+        else if (arg == "--tile" && more) job.tile = atoi(argv[++i]);
+        else if (arg == "--depth" && more) job.depth = atoi(argv[++i]);
+        else if (arg == "--timeout" && more) timeout = atof(argv[++i]);
+        else if (arg == "--attempts" && more) max_attempts = atoi(argv[++i]);
+        else if (arg == "--crash-after" && more) crash_after = atoi(argv[++i]);
+        else if (arg == "--camera" && i + 6 < argc) {
+            job.position = Vector3(atof(argv[i + 1]), atof(argv[i + 2]), atof(argv[i + 3]));
+            job.target = Vector3(atof(argv[i + 4]), atof(argv[i + 5]), atof(argv[i + 6]));
+            i += 6;
+        }
+        else job.meshes.push_back(arg);
+    }
+    if (job.meshes.empty()) job.meshes.push_back("inputs/icosahedron.obj");
+    if (job.width < 1 || job.height < 1 || job.tile < 1) {
+        cerr << "Tamanho inválido" << endl;
+        return 1;
+    }
+
+    int listener = Socket::listen_at(address);
+    if (listener < 0) {
+        cerr << "Erro ao escutar em " << address << endl;
+        return 1;
+    }
+    // Os trabalhadores locais são criados antes de qualquer thread do coordenador
+    vector<pid_t> children;
+    for (int k = 0; k < spawn; k++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            ::close(listener);
+            _exit(worker(address, k == 0? crash_after : -1));
+        }
+        if (pid > 0) children.push_back(pid);
+    }
+
+    auto start = chrono::steady_clock::now();
+    ImageFormat format = (output.size() > 4 && output.substr(output.size() - 4) == ".pfm")? ImageFormat::PFM : ImageFormat::PPM;
+    Framebuffer image(job.width, job.height);
+    unique_ptr<ImageSink> sink;
+    if (output == "-") sink.reset(new StreamSink(cout));
+    else sink.reset(new FileSink(output, ImageWriter::encoded_size(job.width, job.height, format)));
+    ImageWriter writer(image, format, *sink);
+
+    Coordinator farm(job, image, writer);
+    farm.timeout = timeout;
+    farm.max_attempts = max_attempts;
+    farm.spawned = spawn > 0;
+    bool ok = farm.run(listener, children);
+    ::close(listener);
+    if (!Socket::is_tcp(address)) ::unlink(address.c_str());
+    ok = writer.finish() && ok;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    clog << (ok? "Imagem pronta em " : "Falhou depois de ") << seconds << " s" << endl;
+    return ok? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    string mode = (argc > 1)? argv[1] : "";
+    if (mode == "coordinator" && argc >= 4) return coordinator(argc, argv);
+    if (mode == "worker" && argc >= 3) {
+        int crash_after = (argc >= 5 && string(argv[3]) == "--crash-after")? atoi(argv[4]) : -1;
+        return worker(argv[2], crash_after);
+    }
+    cerr << "Uso: " << argv[0] << " coordinator <endereço> <saída> [opções] [malha.obj ...]\n"
+         << "     " << argv[0] << " worker <endereço> [--crash-after N]" << endl;
+    return 1;
+}
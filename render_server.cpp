@@ -0,0 +1,226 @@
+// Servidor de renderização: carrega a cena uma vez (malhas, BVHs) e atende pedidos de
+// quadros por um socket UNIX local, sem pagar a inicialização do processo a cada vista.
+// Cada conexão é atendida numa thread própria; os blocos de todos os quadros em
+// andamento dividem um único ThreadPool.
+//
+// Uso: g++ -O2 -pthread render_server.cpp -o render_server
+//      ./render_server <socket> [--threads N] [malha.obj ...]
+//      ./render_server --request <socket> "<pedido>" <saída>   (cliente de teste)
+// Sem malhas, a cena é a de main.cpp (chão e inputs/icosahedron.obj). As malhas passam
+// pelo MeshCache, então a partir da segunda execução a carga é só o mapeamento do cache.
+//
+// Protocolo, uma linha por pedido (vários pedidos por conexão):
+//   render <largura> <altura> <px> <py> <pz> <alvo_x> <alvo_y> <alvo_z> [opções...]
+// opções: ppm | pfm, light <x> <y> <z> <r> <g> <b> (repetível; substitui a luz padrão),
+//         ambient <r> <g> <b>, depth <n>, aa <n>, budget <ms>
+// Com budget, o quadro é renderizado em passos progressivos (Camera::render_progressive)
+// e a resposta traz o melhor passo concluído no prazo; sem passo concluído, "erro prazo".
+// Resposta: "ok <bytes>", os bytes da imagem (enviados enquanto ela é renderizada) e
+// "fim <ms>" com a latência do pedido; ou "erro <mensagem>". "quit" fecha a conexão.
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Raytracing.hpp"
+#include "Socket.hpp"
+using namespace std;
+
+static mutex log_mutex;
+
+class RenderServer {
+    public:
+        RenderServer(const Scene &scene, ThreadPool &pool): scene {scene}, pool {pool} {}
+
+        void serve(int listener) {
+            while (true) {
+                int client = ::accept(listener, nullptr, nullptr);
+                if (client < 0) {
+                    if (errno == EINTR) continue;
+                    perror("accept");
+                    return;
+                }
+                thread(&RenderServer::handle, this, client).detach();
+            }
+        }
+
+    private:
+        const Scene &scene;
+        ThreadPool &pool;
+
+        void handle(int client) {
+            string line;
+            while (Socket::recv_line(client, line)) {
+                if (line == "quit") break;
+                if (line.empty()) continue;
+                if (!render(client, line)) break;
+            }
+            ::close(client);
+        }
+
+        // Atende um pedido; retorna false se a conexão caiu
+        bool render(int client, const string &request) {
+            auto start = chrono::steady_clock::now();
+            unique_ptr<Camera> camera;
+            ImageFormat format = ImageFormat::PPM;
+            double budget = 0;
+            string error = parse(request, camera, format, budget);
+            if (!error.empty()) return Socket::send_line(client, "erro " + error);
+
+            size_t bytes = ImageWriter::encoded_size(camera->screen_width, camera->screen_height, format);
+            int passes = 0;
+            if (budget > 0) {
+                // O prazo conta desde a chegada do pedido; a imagem só é enviada no fim
+                double seconds = budget / 1000 - chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                Framebuffer image(camera->screen_width, camera->screen_height);
+                passes = camera->render_progressive(scene, image, seconds);
+                if (passes == 0) return Socket::send_line(client, "erro prazo");
+                if (!Socket::send_line(client, "ok " + to_string(bytes))) return false;
+                SocketSink sink(client);
+                ImageWriter writer(image, format, sink);
+                writer.all_rows_ready();
+                if (!writer.finish()) return false;
+            } else {
+                if (!Socket::send_line(client, "ok " + to_string(bytes))) return false;
+                SocketSink sink(client);
+                if (!camera->draw(scene, sink, format)) return false;
+            }
+
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            {
+                lock_guard<mutex> lock(log_mutex);
+                clog << "render " << camera->screen_width << "x" << camera->screen_height << ": " << ms << " ms";
+                if (budget > 0) clog << " (" << passes << " passos em " << budget << " ms)";
+                clog << endl;
+            }
+            return Socket::send_line(client, "fim " + to_string(ms));
+        }
+
+        // Monta a câmera do pedido; retorna a mensagem de erro, vazia se o pedido é válido
+        string parse(const string &request, unique_ptr<Camera> &camera, ImageFormat &format, double &budget) {
+            istringstream in(request);
+            string command;
+            int width, height;
+            real px, py, pz, tx, ty, tz;
+            in >> command;
+            if (command != "render") return "comando desconhecido: " + command;
+            if (!(in >> width >> height >> px >> py >> pz >> tx >> ty >> tz)) return "pedido incompleto";
+            if (width < 1 || height < 1 || width > 16384 || height > 16384) return "resolução inválida";
+            Vector3 position(px, py, pz), target(tx, ty, tz);
+            if (position == target) return "a câmera e o alvo coincidem";
+
+            camera.reset(new Camera(position, target));
+            camera->screen_width = width;
+            camera->screen_height = height;
+            camera->pool = &pool;
+            camera->ambient_light = Color(0.1, 0.1, 0.4);
+            bool default_light = true;
+            string option;
+            while (in >> option) {
+                if (option == "ppm") format = ImageFormat::PPM;
+                else if (option == "pfm") format = ImageFormat::PFM;
+                else if (option == "light") {
+                    Camera::Light light;
+                    real r, g, b;
+                    if (!(in >> light.position >> r >> g >> b)) return "luz incompleta";
+                    light.color = Color(r, g, b);
+                    if (default_light) camera->lights.clear();
+                    default_light = false;
+                    camera->lights.push_back(light);
+                } else if (option == "ambient") {
+                    real r, g, b;
+                    if (!(in >> r >> g >> b)) return "ambient incompleto";
+                    camera->ambient_light = Color(r, g, b);
+                } else if (option == "depth") {
+                    if (!(in >> camera->max_depth) || camera->max_depth < 0) return "depth inválido";
+                } else if (option == "aa") {
+                    if (!(in >> camera->aa_samples) || camera->aa_samples < 1 || camera->aa_samples > 16) return "aa inválido";
+                } else if (option == "budget") {
+                    if (!(in >> budget) || budget <= 0) return "budget inválido";
+                } else {
+                    return "opção desconhecida: " + option;
+                }
+            }
+            if (default_light) camera->lights.emplace_back(Vector3(0, 8, -5));
+            return "";
+        }
+};
+
+// Cliente de teste: envia um pedido, grava a imagem em 'output' e mostra a latência
+static int request(const string &socket_path, const string &line, const string &output) {
+    int fd = Socket::connect_unix(socket_path);
+    if (fd < 0) {
+        cerr << "Erro ao conectar em " << socket_path << endl;
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    string reply;
+    if (!Socket::send_line(fd, line) || !Socket::recv_line(fd, reply)) {
+        cerr << "Conexão perdida" << endl;
+        return 1;
+    }
+    if (reply.compare(0, 3, "ok ") != 0) {
+        cerr << reply << endl;
+        return 1;
+    }
+    vector<char> image(stoull(reply.substr(3)));
+    if (!Socket::recv_all(fd, image.data(), image.size()) || !Socket::recv_line(fd, reply)) {
+        cerr << "Conexão perdida" << endl;
+        return 1;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    Socket::send_line(fd, "quit");
+    ::close(fd);
+    ofstream(output, ios::binary).write(image.data(), image.size());
+    cout << "servidor: " << reply.substr(4) << " ms, total: " << ms << " ms" << endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 5 && string(argv[1]) == "--request") return request(argv[2], argv[3], argv[4]);
+    if (argc < 2) {
+        cerr << "Uso: " << argv[0] << " <socket> [--threads N] [malha.obj ...]" << endl;
+        return 1;
+    }
+    string socket_path = argv[1];
+    int threads = 0;
+    vector<string> files;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else files.push_back(arg);
+    }
+    if (files.empty()) files.push_back("inputs/icosahedron.obj");
+
+    auto start = chrono::steady_clock::now();
+    // Chão, materiais e malhas vivem na arena da cena e são liberados com ela
+    Scene scene;
+    Object::Material *floor = scene.create_material();
+    floor->diffuse = Color(0.6, 0.3, 0);
+    floor->ambient = Color(0.1, 0.05, 0);
+    scene.create<Plane>(Vector3(0, 0, 0), Vector3(0, 1, 0))->material = floor;
+    for (const string &file : files) {
+        if (!MeshCache::open(*scene.create<TriangleMesh>(), file)) {
+            cerr << "Erro ao carregar " << file << endl;
+            return 1;
+        }
+    }
+    scene.build();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int listener = Socket::listen_unix(socket_path);
+    if (listener < 0) {
+        cerr << "Erro ao escutar em " << socket_path << endl;
+        return 1;
+    }
+    ThreadPool pool(threads > 0? threads : ThreadPool::default_thread_count());
+    clog << "Cena com " << scene.objects.size() << " objetos carregada em " << seconds << " s; "
+         << pool.size() << " threads; escutando em " << socket_path << endl;
+    RenderServer(scene, pool).serve(listener);
+    ::close(listener);
+    return 0;
+}